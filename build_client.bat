@@ -4,15 +4,30 @@ gcc -fdiagnostics-color=always -g ^
 %WORKSPACE_FOLDER%/src/client/main.c ^
 %WORKSPACE_FOLDER%/src/client/client.c ^
 %WORKSPACE_FOLDER%/src/shared/game.c ^
+%WORKSPACE_FOLDER%/src/shared/entity_pool.c ^
 %WORKSPACE_FOLDER%/src/client/texture.c ^
 %WORKSPACE_FOLDER%/src/client/render.c ^
 %WORKSPACE_FOLDER%/src/client/audio.c ^
+%WORKSPACE_FOLDER%/src/client/prediction.c ^
+%WORKSPACE_FOLDER%/src/client/interpolation.c ^
+%WORKSPACE_FOLDER%/src/client/network.c ^
+%WORKSPACE_FOLDER%/src/client/world_mesh.c ^
 %WORKSPACE_FOLDER%/src/shared/utils.c ^
 %WORKSPACE_FOLDER%/src/shared/vector.c ^
 %WORKSPACE_FOLDER%/src/shared/settings.c ^
+%WORKSPACE_FOLDER%/src/shared/spsc_queue.c ^
+%WORKSPACE_FOLDER%/src/shared/net_buffer.c ^
+%WORKSPACE_FOLDER%/src/shared/snapshot.c ^
+%WORKSPACE_FOLDER%/src/shared/protocol.c ^
+%WORKSPACE_FOLDER%/src/shared/tcp_stream.c ^
+%WORKSPACE_FOLDER%/src/shared/movement.c ^
+%WORKSPACE_FOLDER%/src/shared/occupancy.c ^
+%WORKSPACE_FOLDER%/src/shared/chunk.c ^
+%WORKSPACE_FOLDER%/src/shared/cell_definitions.c ^
+%WORKSPACE_FOLDER%/src/shared/visibility.c ^
 -o %WORKSPACE_FOLDER%/game.exe ^
 -I%WORKSPACE_FOLDER%/include ^
 -L%WORKSPACE_FOLDER%/lib ^
--lmingw32 -lSDL2main -lSDL2 -lSDL2_image -lSDL2_mixer -lSDL2_net -lopengl32 -lglu32
+-lmingw32 -lSDL2main -lSDL2 -lSDL2_image -lSDL2_mixer -lSDL2_net -lws2_32 -lopengl32 -lglu32
 
 echo Build client completed.
\ No newline at end of file
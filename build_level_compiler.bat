@@ -0,0 +1,23 @@
+set WORKSPACE_FOLDER=%cd%
+
+gcc -fdiagnostics-color=always -g ^
+%WORKSPACE_FOLDER%/src/tools/level_compiler.c ^
+%WORKSPACE_FOLDER%/src/tools/visibility_compiler.c ^
+%WORKSPACE_FOLDER%/src/server/world.c ^
+%WORKSPACE_FOLDER%/src/shared/game.c ^
+%WORKSPACE_FOLDER%/src/shared/entity_pool.c ^
+%WORKSPACE_FOLDER%/src/shared/occupancy.c ^
+%WORKSPACE_FOLDER%/src/shared/chunk.c ^
+%WORKSPACE_FOLDER%/src/shared/cell_definitions.c ^
+%WORKSPACE_FOLDER%/src/shared/level_file.c ^
+%WORKSPACE_FOLDER%/src/shared/visibility.c ^
+%WORKSPACE_FOLDER%/src/shared/voxel.c ^
+%WORKSPACE_FOLDER%/src/shared/job_system.c ^
+%WORKSPACE_FOLDER%/src/shared/utils.c ^
+%WORKSPACE_FOLDER%/src/shared/vector.c ^
+-o %WORKSPACE_FOLDER%/level_compiler.exe ^
+-I%WORKSPACE_FOLDER%/include ^
+-L%WORKSPACE_FOLDER%/lib ^
+-lmingw32 -lSDL2main -lSDL2 -lSDL2_image
+
+echo Build level compiler completed.
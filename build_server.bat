@@ -3,14 +3,29 @@ set WORKSPACE_FOLDER=%cd%
 gcc -fdiagnostics-color=always -g ^
 %WORKSPACE_FOLDER%/src/server/server.c ^
 %WORKSPACE_FOLDER%/src/shared/game.c ^
+%WORKSPACE_FOLDER%/src/shared/entity_pool.c ^
 %WORKSPACE_FOLDER%/src/server/game_logic.c ^
+%WORKSPACE_FOLDER%/src/server/spatial_hash.c ^
 %WORKSPACE_FOLDER%/src/server/world.c ^
 %WORKSPACE_FOLDER%/src/shared/settings.c ^
+%WORKSPACE_FOLDER%/src/shared/spsc_queue.c ^
+%WORKSPACE_FOLDER%/src/shared/net_buffer.c ^
+%WORKSPACE_FOLDER%/src/shared/snapshot.c ^
+%WORKSPACE_FOLDER%/src/shared/protocol.c ^
+%WORKSPACE_FOLDER%/src/shared/tcp_stream.c ^
+%WORKSPACE_FOLDER%/src/shared/movement.c ^
+%WORKSPACE_FOLDER%/src/shared/occupancy.c ^
+%WORKSPACE_FOLDER%/src/shared/chunk.c ^
+%WORKSPACE_FOLDER%/src/shared/cell_definitions.c ^
+%WORKSPACE_FOLDER%/src/shared/level_file.c ^
+%WORKSPACE_FOLDER%/src/shared/visibility.c ^
+%WORKSPACE_FOLDER%/src/shared/voxel.c ^
+%WORKSPACE_FOLDER%/src/shared/job_system.c ^
 %WORKSPACE_FOLDER%/src/shared/utils.c ^
 %WORKSPACE_FOLDER%/src/shared/vector.c ^
 -o %WORKSPACE_FOLDER%/server.exe ^
 -I%WORKSPACE_FOLDER%/include ^
 -L%WORKSPACE_FOLDER%/lib ^
--lmingw32 -lSDL2main -lSDL2 -lSDL2_image -lSDL2_net -lopengl32 -lglu32
+-lmingw32 -lSDL2main -lSDL2 -lSDL2_image -lSDL2_net -lws2_32 -lopengl32 -lglu32
 
 echo Build server completed.
@@ -10,10 +10,22 @@
 #include "render.h"
 #include "audio.h"
 #include "texture.h"
+#include "prediction.h"
+#include "interpolation.h"
+#include "network.h"
+#include "world_mesh.h"
 #include "../shared/game.h"
 #include "../shared/vector.h"
 #include "../shared/utils.h"
 #include "../shared/settings.h"
+#include "../shared/net_buffer.h"
+#include "../shared/snapshot.h"
+#include "../shared/protocol.h"
+#include "../shared/tcp_stream.h"
+#include "../shared/occupancy.h"
+#include "../shared/chunk.h"
+#include "../shared/cell_definitions.h"
+#include "../shared/visibility.h"
 
 static bool quit = false;
 const bool DEBUG_LOG = true;
@@ -25,6 +37,7 @@ SDL_Surface* base_fg_texture;
 SDL_Surface* base_bg_texture;
 
 #define MAX_TEXTURES 128
+#define NETWORK_STALL_THRESHOLD 0.25 // Seconds without a snapshot before the connection counts as stalled
 TextureInfo texture_map[MAX_TEXTURES];
 
 bool have_audio = false;
@@ -36,6 +49,11 @@ GLuint test_texture;
 GLuint health_icon_texture;
 GameState game_state;
 World world;
+static Prediction prediction;
+static InterpolationBuffer interpolation;
+static Snapshot render_snapshot;
+static ReceivedSnapshot received_snapshot;
+GameState server_state;
 
 bool init_engine() {
     //Init SDL and create window
@@ -202,6 +220,49 @@ void poll_events() {
     }
 }
 
+static void send_inputs(UDPsocket udp_socket, UDPpacket* packet, IPaddress server_ip, const InputPacket* input_packet) {
+    NetBuffer buffer;
+    net_buffer_init(&buffer, packet->data, packet->maxlen);
+    write_input_packet(&buffer, input_packet);
+    packet->len = buffer.length;
+    packet->address = server_ip;
+    SDLNet_UDP_Send(udp_socket, -1, packet);
+}
+
+// Blocks until the initial game state has arrived, however many reads that takes.
+// The chunks of the world follow on the same stream and are decoded by the network thread.
+static bool receive_initial_game_state(TcpStream* stream, InitialGameState* out_initial_game_state, World* out_world) {
+    bool received_state = false;
+    bool valid = true;
+    while (valid && !received_state) {
+        Uint8 type;
+        const Uint8* data;
+        int length;
+        if (tcp_stream_next_frame(stream, &type, &data, &length)) {
+            if (type == MESSAGE_INITIAL_GAME_STATE && !received_state && length == sizeof(InitialGameState)) {
+                memcpy(out_initial_game_state, data, sizeof(InitialGameState));
+                if (out_initial_game_state->cell_definitions_checksum != get_cell_definitions_checksum()) {
+                    printf("The server has different cell definitions.\n");
+                    return false;
+                }
+                valid = world_init(out_world, out_initial_game_state->world_width, out_initial_game_state->world_height,
+                                   out_initial_game_state->world_layers) &&
+                        out_initial_game_state->world_chunk_count >= 0 &&
+                        out_initial_game_state->world_chunk_count <= out_world->chunks_x * out_world->chunks_y;
+                out_world->gravity = out_initial_game_state->gravity;
+                received_state = true;
+            }
+        } else if (!tcp_stream_receive(stream)) {
+            valid = false;
+        }
+    }
+
+    if (!valid && received_state) {
+        world_free(out_world);
+    }
+    return valid && received_state;
+}
+
 void main_loop() {
     SDL_SetRelativeMouseMode(SDL_TRUE);
 
@@ -211,12 +272,25 @@ void main_loop() {
 
     InputState input_state = {0};
     InputState prev_input_state = {0};
+    InputState recent_inputs[INPUT_REDUNDANCY];
+    int recent_input_count = 0;
+    Uint32 input_sequence = 0;
+    double last_snapshot_time = get_time_seconds();
+    bool network_stalled = false;
+    int network_stall_count = 0;
 
     const char* server_hostname = get_setting_string("server_host");
     const Uint16 server_port = get_setting_int("server_port");
 
-    // Set up texture handler
-    init_texture_handler("cell_definitions.txt", base_bg_texture);
+    // Cells are indices into the cell definitions, the server has loaded the same file
+    if (!load_cell_definitions("cell_definitions.txt")) {
+        SDL_SetRelativeMouseMode(SDL_FALSE);
+        return;
+    }
+    if (!init_texture_handler(base_bg_texture)) {
+        SDL_SetRelativeMouseMode(SDL_FALSE);
+        return;
+    }
 
     // Connect to the server
     IPaddress server_ip;
@@ -238,18 +312,56 @@ void main_loop() {
 
     // Receive initial game state from server
     InitialGameState initial_game_state;
-    int received_initial = SDLNet_TCP_Recv(server_socket, &initial_game_state, sizeof(initial_game_state));
-    if (received_initial <= 0) {
+    TcpStream server_stream;
+    tcp_stream_init(&server_stream, server_socket);
+    if (!receive_initial_game_state(&server_stream, &initial_game_state, &world)) {
         printf("Error receiving initial game state from server.\n");
+        tcp_stream_free(&server_stream);
+        SDLNet_TCP_Close(server_socket);
+        SDL_SetRelativeMouseMode(SDL_FALSE);
+        return;
+    }
+
+    if (!init_world_mesh(&world)) {
+        tcp_stream_free(&server_stream);
         SDLNet_TCP_Close(server_socket);
+        world_free(&world);
         SDL_SetRelativeMouseMode(SDL_FALSE);
         return;
     }
 
     // Prepare for game start
     int player_id = initial_game_state.player_id;
-    world = initial_game_state.world;
+    if (!game_state_init(&game_state, initial_game_state.max_players, initial_game_state.max_projectiles) ||
+        !game_state_init(&server_state, initial_game_state.max_players, initial_game_state.max_projectiles)) {
+        tcp_stream_free(&server_stream);
+        SDLNet_TCP_Close(server_socket);
+        SDL_SetRelativeMouseMode(SDL_FALSE);
+        return;
+    }
+    interpolation_init(&interpolation, initial_game_state.tick_rate, get_setting_float("interpolation_delay"));
+    prediction_init(&prediction, initial_game_state.tick_rate);
+
+    // Gameplay traffic goes over UDP, the TCP connection streams in the world and then notices when the server goes away
+    UDPsocket udp_socket = SDLNet_UDP_Open(0);
+    if (!udp_socket) {
+        printf("Error opening UDP socket: %s\n", SDLNet_GetError());
+        tcp_stream_free(&server_stream);
+        SDLNet_TCP_Close(server_socket);
+        SDL_SetRelativeMouseMode(SDL_FALSE);
+        return;
+    }
+    UDPpacket* packet = SDLNet_AllocPacket(MAX_PACKET_SIZE);
+    if (!network_start(udp_socket, &server_stream, &initial_game_state)) {
+        SDLNet_FreePacket(packet);
+        SDLNet_UDP_Close(udp_socket);
+        SDLNet_TCP_Close(server_socket);
+        SDL_SetRelativeMouseMode(SDL_FALSE);
+        return;
+    }
     SDL_ShowWindow(window);
+    int received_chunks = 0;
+    double world_start_time = get_time_seconds();
 
     while (!quit) {
         Uint32 currentFrameTime = SDL_GetTicks();
@@ -258,16 +370,85 @@ void main_loop() {
         // Process input and send input state to server
         prev_input_state = input_state;
         input_state = process_input(&prev_input_state);
-        SDLNet_TCP_Send(server_socket, &input_state, sizeof(input_state));
+        input_state.delta_time = fminf((currentFrameTime - lastFrameTime) / 1000.0f, 0.1f);
+        input_state.sequence = ++input_sequence;
+
+        // Every packet repeats the last few inputs so a lost packet doesn't lose input
+        memmove(&recent_inputs[1], &recent_inputs[0], sizeof(InputState) * (INPUT_REDUNDANCY - 1));
+        recent_inputs[0] = input_state;
+        if (recent_input_count < INPUT_REDUNDANCY) {
+            recent_input_count++;
+        }
+        InputPacket input_packet = {
+            .player_id = player_id,
+            .connection_token = initial_game_state.connection_token,
+            .snapshot_ack = network_get_snapshot_ack(),
+            .input_count = recent_input_count
+        };
+        memcpy(input_packet.inputs, recent_inputs, sizeof(InputState) * recent_input_count);
+        send_inputs(udp_socket, packet, server_ip, &input_packet);
+
+        // The world keeps arriving nearest first after the game has started, each chunk is usable right away
+        ReceivedChunk received_chunk;
+        while (network_poll_world_chunk(&received_chunk)) {
+            if (set_chunk(&world, received_chunk.chunk_x, received_chunk.chunk_y, received_chunk.chunk)) {
+                build_chunk_occupancy(&world, received_chunk.chunk);
+                invalidate_world_mesh_chunk(received_chunk.chunk_x, received_chunk.chunk_y);
+            } else {
+                free(received_chunk.chunk);
+            }
+            if (++received_chunks == initial_game_state.world_chunk_count) {
+                printf("Received %d world chunks in %.0f ms.\n", received_chunks, (get_time_seconds() - world_start_time) * 1000.0);
+            }
+        }
+        update_world_mesh(&world);
+        // The visibility table follows the last chunk, until then every chunk is drawn
+        Visibility received_visibility;
+        if (network_poll_world_visibility(&received_visibility)) {
+            visibility_free(&world.visibility);
+            world.visibility = received_visibility;
+        }
 
-        // Receive game state from server
-        int received = SDLNet_TCP_Recv(server_socket, &game_state, sizeof(game_state));
-        if (received <= 0) {
+        // Move the local player right away instead of waiting for the server
+        prediction_add_input(&prediction, &world, &input_state);
+
+        // Apply whatever snapshots the network thread has decoded since the last frame, never waiting for more
+        bool received = false;
+        Uint32 input_ack = 0;
+        double now = get_time_seconds();
+        while (network_poll_snapshot(&received_snapshot)) {
+            snapshot_apply(&received_snapshot.snapshot, &server_state);
+            interpolation_add_snapshot(&interpolation, &received_snapshot.snapshot, received_snapshot.receive_time);
+            input_ack = received_snapshot.input_ack;
+            received = true;
+        }
+        if (received) {
+            if (server_state.players[player_id].connected) {
+                prediction_reconcile(&prediction, &world, &server_state.players[player_id], input_ack);
+            }
+            if (network_stalled) {
+                printf("Network stall %d ended after %.0f ms.\n", network_stall_count, (now - last_snapshot_time) * 1000.0);
+                network_stalled = false;
+            }
+            last_snapshot_time = now;
+        } else if (!network_stalled && now - last_snapshot_time > NETWORK_STALL_THRESHOLD) {
+            network_stalled = true;
+            network_stall_count++;
+        }
+
+        // Remote players and projectiles are drawn a little in the past, between two snapshots
+        if (interpolation_sample(&interpolation, now, &render_snapshot)) {
+            snapshot_apply(&render_snapshot, &game_state);
+        }
+        if (!network_is_connected()) {
             printf("Server disconnected or an error occurred.\n");
             break;
         }
 
         Player* player = &game_state.players[player_id];
+        if (prediction.has_player) {
+            *player = prediction.player;
+        }
 
         // Play sounds on the client
         play_sounds(&game_state, player_id);
@@ -277,7 +458,7 @@ void main_loop() {
         if (player->death_timer <= 0.0f) {
             render_world(&world, player, test_texture);
             render_projectiles(&game_state, projectile_texture);
-            render_players(game_state.players, player_id, MAX_CLIENTS, player_texture);
+            render_players(&game_state, player_id, player_texture);
         }
 
         // Render UI elements
@@ -293,6 +474,14 @@ void main_loop() {
         lastFrameTime = currentFrameTime;
     }
 
+    network_stop();
+    printf("Network stalls: %d, dropped snapshots: %d\n", network_stall_count, network_get_dropped_snapshots());
+    SDLNet_FreePacket(packet);
+    SDLNet_UDP_Close(udp_socket);
     SDLNet_TCP_Close(server_socket);
+    game_state_free(&game_state);
+    game_state_free(&server_state);
+    free_world_mesh();
+    world_free(&world);
     SDL_SetRelativeMouseMode(SDL_FALSE);
 }
@@ -0,0 +1,138 @@
+#include <math.h>
+#include <string.h>
+
+#include "interpolation.h"
+
+#define MAX_EXTRAPOLATION_TIME 0.1
+#define CLOCK_SMOOTHING 0.05
+#define CLOCK_RESYNC_THRESHOLD 0.25
+
+static const Snapshot* get_snapshot(InterpolationBuffer* buffer, int age);
+static double get_server_time(InterpolationBuffer* buffer, const Snapshot* snapshot);
+static void blend_snapshots(const Snapshot* from, const Snapshot* to, float t, Snapshot* out_snapshot);
+static void blend_entities(const NetEntity* from, int from_count, const NetEntity* to, int to_count,
+                           const int* blended_fields, int blended_count, int wrapped_field, float t, NetEntity* out_entities);
+
+static const int PLAYER_BLENDED_FIELDS[] = {
+    PLAYER_FIELD_X, PLAYER_FIELD_Y, PLAYER_FIELD_Z, PLAYER_FIELD_YAW, PLAYER_FIELD_PITCH
+};
+static const int PROJECTILE_BLENDED_FIELDS[] = {
+    PROJECTILE_FIELD_X, PROJECTILE_FIELD_Y, PROJECTILE_FIELD_Z
+};
+
+void interpolation_init(InterpolationBuffer* buffer, int tick_rate, float delay) {
+    buffer->newest = -1;
+    buffer->count = 0;
+    buffer->tick_rate = tick_rate > 0 ? tick_rate : 60;
+    buffer->delay = delay;
+    buffer->clock_offset = 0.0;
+    buffer->has_clock = false;
+}
+
+void interpolation_add_snapshot(InterpolationBuffer* buffer, const Snapshot* snapshot, double local_time) {
+    if (buffer->count > 0 && snapshot->tick <= get_snapshot(buffer, 0)->tick) {
+        return; // Only ever append newer snapshots
+    }
+
+    buffer->newest = (buffer->newest + 1) % INTERPOLATION_BUFFER_SIZE;
+    snapshot_copy(&buffer->snapshots[buffer->newest], snapshot);
+    if (buffer->count < INTERPOLATION_BUFFER_SIZE) {
+        buffer->count++;
+    }
+
+    // Track the server clock, smoothing out packet jitter but resyncing after a big jump
+    double offset_sample = get_server_time(buffer, snapshot) - local_time;
+    if (!buffer->has_clock || fabs(offset_sample - buffer->clock_offset) > CLOCK_RESYNC_THRESHOLD) {
+        buffer->clock_offset = offset_sample;
+        buffer->has_clock = true;
+    } else {
+        buffer->clock_offset += (offset_sample - buffer->clock_offset) * CLOCK_SMOOTHING;
+    }
+}
+
+bool interpolation_sample(InterpolationBuffer* buffer, double local_time, Snapshot* out_snapshot) {
+    if (buffer->count == 0) {
+        return false;
+    }
+
+    double render_time = local_time + buffer->clock_offset - buffer->delay;
+    const Snapshot* newest = get_snapshot(buffer, 0);
+    if (buffer->count == 1 || render_time <= get_server_time(buffer, get_snapshot(buffer, buffer->count - 1))) {
+        snapshot_copy(out_snapshot, buffer->count == 1 ? newest : get_snapshot(buffer, buffer->count - 1));
+        return true;
+    }
+
+    // Find the pair of snapshots around the render time
+    const Snapshot* from = get_snapshot(buffer, 1);
+    const Snapshot* to = newest;
+    for (int age = 1; age < buffer->count; age++) {
+        const Snapshot* older = get_snapshot(buffer, age);
+        if (get_server_time(buffer, older) <= render_time) {
+            from = older;
+            to = get_snapshot(buffer, age - 1);
+            break;
+        }
+    }
+
+    double from_time = get_server_time(buffer, from);
+    double to_time = get_server_time(buffer, to);
+    double t = (render_time - from_time) / (to_time - from_time);
+
+    // Past the newest snapshot we extrapolate along the last known motion, but only briefly
+    double max_t = 1.0 + MAX_EXTRAPOLATION_TIME / (to_time - from_time);
+    if (t > max_t) {
+        t = max_t;
+    }
+
+    blend_snapshots(from, to, (float)t, out_snapshot);
+    return true;
+}
+
+static const Snapshot* get_snapshot(InterpolationBuffer* buffer, int age) {
+    int index = (buffer->newest - age + INTERPOLATION_BUFFER_SIZE) % INTERPOLATION_BUFFER_SIZE;
+    return &buffer->snapshots[index];
+}
+
+static double get_server_time(InterpolationBuffer* buffer, const Snapshot* snapshot) {
+    return (double)snapshot->tick / buffer->tick_rate;
+}
+
+static void blend_snapshots(const Snapshot* from, const Snapshot* to, float t, Snapshot* out_snapshot) {
+    // The newer snapshot decides which entities exist and everything that isn't blended
+    out_snapshot->tick = to->tick;
+    out_snapshot->players_count = to->players_count;
+    out_snapshot->projectiles_count = to->projectiles_count;
+
+    blend_entities(from->players, from->players_count, to->players, to->players_count,
+                   PLAYER_BLENDED_FIELDS, sizeof(PLAYER_BLENDED_FIELDS) / sizeof(int), PLAYER_FIELD_YAW, t,
+                   out_snapshot->players);
+    blend_entities(from->projectiles, from->projectiles_count, to->projectiles, to->projectiles_count,
+                   PROJECTILE_BLENDED_FIELDS, sizeof(PROJECTILE_BLENDED_FIELDS) / sizeof(int), -1, t,
+                   out_snapshot->projectiles);
+}
+
+static void blend_entities(const NetEntity* from, int from_count, const NetEntity* to, int to_count,
+                           const int* blended_fields, int blended_count, int wrapped_field, float t, NetEntity* out_entities) {
+    // Both lists are sorted by id
+    int f = 0;
+    for (int i = 0; i < to_count; i++) {
+        out_entities[i] = to[i];
+        while (f < from_count && from[f].id < to[i].id) {
+            f++;
+        }
+        if (f >= from_count || from[f].id != to[i].id) {
+            continue; // New entity, nothing to blend from
+        }
+
+        for (int k = 0; k < blended_count; k++) {
+            int field = blended_fields[k];
+            Sint32 start = from[f].fields[field];
+            Sint32 delta = to[i].fields[field] - start;
+            if (field == wrapped_field) {
+                delta = (Sint16)(Uint16)delta; // Take the short way around
+            }
+            Sint32 value = start + (Sint32)lroundf(delta * t);
+            out_entities[i].fields[field] = field == wrapped_field ? (value & 0xFFFF) : value;
+        }
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef INTERPOLATION_H
+#define INTERPOLATION_H
+
+#include <stdbool.h>
+#include "../shared/snapshot.h"
+
+#define INTERPOLATION_BUFFER_SIZE 32
+
+// Recent snapshots stamped with server time, sampled slightly in the past so
+// remote entities can be drawn between two known states
+typedef struct InterpolationBuffer {
+    Snapshot snapshots[INTERPOLATION_BUFFER_SIZE]; // Ring in tick order
+    int newest;
+    int count;
+    int tick_rate;
+    float delay;          // How far behind the estimated server time we render, in seconds
+    double clock_offset;  // Estimated server time minus local time
+    bool has_clock;
+} InterpolationBuffer;
+
+void interpolation_init(InterpolationBuffer* buffer, int tick_rate, float delay);
+void interpolation_add_snapshot(InterpolationBuffer* buffer, const Snapshot* snapshot, double local_time);
+bool interpolation_sample(InterpolationBuffer* buffer, double local_time, Snapshot* out_snapshot);
+
+#endif // INTERPOLATION_H
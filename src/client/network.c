@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_atomic.h>
+
+#include "network.h"
+#include "../shared/net_buffer.h"
+#include "../shared/protocol.h"
+#include "../shared/spsc_queue.h"
+#include "../shared/utils.h"
+#include "../shared/visibility.h"
+
+#define SNAPSHOT_QUEUE_CAPACITY 16
+#define NETWORK_POLL_TIMEOUT_MS 10
+
+static UDPsocket g_udp_socket;
+static TcpStream g_server_stream;
+static SDL_Thread* g_thread = NULL;
+// Snapshots are too big to copy through a queue whole, so the queues carry indices into a pool of
+// slots: the network thread takes a free slot, fills it and queues it, the render thread copies out the
+// live entities and hands the slot back
+static ReceivedSnapshot g_snapshot_slots[SNAPSHOT_QUEUE_CAPACITY];
+static SpscQueue g_snapshot_queue;
+static SpscQueue g_free_snapshot_slots;
+static SpscQueue g_chunk_queue;
+static SpscQueue g_visibility_queue;
+static SDL_atomic_t g_running;
+static SDL_atomic_t g_connected;
+static SDL_atomic_t g_snapshot_ack;
+static SDL_atomic_t g_dropped_snapshots;
+
+// Only touched by the network thread
+static Snapshot g_snapshot_history[SNAPSHOT_HISTORY_SIZE];
+static SnapshotAssembly g_assembly;
+static int g_world_layers;
+static int g_world_width;
+static int g_world_height;
+
+static void handle_packet(UDPpacket* packet) {
+    NetBuffer buffer;
+    net_buffer_init_read(&buffer, packet->data, packet->len);
+    if (read_packet_type(&buffer) != PACKET_SNAPSHOT) {
+        return;
+    }
+
+    Uint32 input_ack;
+    SnapshotHeader header;
+    if (!read_snapshot_packet_header(&buffer, &input_ack) || !snapshot_read_header(&buffer, &header)) {
+        return;
+    }
+    if (header.tick <= (Uint32)SDL_AtomicGet(&g_snapshot_ack) || header.tick < g_assembly.tick) {
+        return; // Duplicate or arrived out of order
+    }
+
+    // A part of a newer tick gives up on any parts still missing from an older one
+    if (header.tick != g_assembly.tick) {
+        snapshot_assembly_begin(&g_assembly, &header);
+    }
+    const Snapshot* baseline = &g_snapshot_history[header.baseline_tick % SNAPSHOT_HISTORY_SIZE];
+    if (!snapshot_decode_part(&buffer, &header, baseline, &g_assembly)) {
+        printf("Failed to decode part %d of snapshot %u.\n", header.part_index, header.tick);
+        return;
+    }
+    Snapshot* snapshot = &g_snapshot_history[header.tick % SNAPSHOT_HISTORY_SIZE];
+    if (!snapshot_assembly_finish(&g_assembly, snapshot)) {
+        return; // Waiting for the other parts
+    }
+
+    int slot;
+    if (spsc_queue_pop(&g_free_snapshot_slots, &slot)) {
+        ReceivedSnapshot* received = &g_snapshot_slots[slot];
+        snapshot_copy(&received->snapshot, snapshot);
+        received->input_ack = input_ack;
+        received->receive_time = get_time_seconds();
+        spsc_queue_push(&g_snapshot_queue, &slot); // Holds every slot, so never full
+    } else {
+        SDL_AtomicIncRef(&g_dropped_snapshots);
+    }
+    SDL_AtomicSet(&g_snapshot_ack, (int)header.tick);
+}
+
+// Decodes whatever complete frames the server stream holds, false if the server sent something broken
+static bool handle_server_frames() {
+    Uint8 type;
+    const Uint8* data;
+    int length;
+    while (tcp_stream_next_frame(&g_server_stream, &type, &data, &length)) {
+        NetBuffer buffer;
+        net_buffer_init_read(&buffer, data, length);
+        if (type == MESSAGE_WORLD_VISIBILITY) {
+            Visibility visibility;
+            if (!read_world_visibility(&buffer, g_world_width, g_world_height, &visibility)) {
+                printf("Failed to decode the world visibility.\n");
+                return false;
+            }
+            // The server only sends one
+            if (!spsc_queue_push(&g_visibility_queue, &visibility)) {
+                visibility_free(&visibility);
+                return false;
+            }
+            continue;
+        }
+        if (type != MESSAGE_WORLD_CHUNK) {
+            continue;
+        }
+        ReceivedChunk received;
+        received.chunk = read_world_chunk(&buffer, g_world_layers, &received.chunk_x, &received.chunk_y);
+        if (!received.chunk) {
+            printf("Failed to decode a world chunk.\n");
+            return false;
+        }
+        // The queue has room for every chunk of the world
+        if (!spsc_queue_push(&g_chunk_queue, &received)) {
+            free(received.chunk);
+            return false;
+        }
+    }
+    return true;
+}
+
+static int network_thread(void* data) {
+    SDLNet_SocketSet socket_set = SDLNet_AllocSocketSet(2);
+    SDLNet_UDP_AddSocket(socket_set, g_udp_socket);
+    SDLNet_TCP_AddSocket(socket_set, g_server_stream.socket);
+    UDPpacket* packet = SDLNet_AllocPacket(MAX_PACKET_SIZE);
+
+    while (SDL_AtomicGet(&g_running)) {
+        int ready = SDLNet_CheckSockets(socket_set, NETWORK_POLL_TIMEOUT_MS);
+        if (ready < 0) {
+            // Waiting would fail again straight away, so give up on the connection instead of spinning
+            printf("Failed to wait on the server sockets: %s\n", SDLNet_GetError());
+            SDL_AtomicSet(&g_connected, 0);
+            break;
+        }
+        if (ready == 0) {
+            continue;
+        }
+
+        // After the handshake the TCP connection carries the rest of the world, then only tells us when it closes
+        if (SDLNet_SocketReady(g_server_stream.socket)) {
+            if (!tcp_stream_receive(&g_server_stream) || !handle_server_frames()) {
+                SDL_AtomicSet(&g_connected, 0);
+                break;
+            }
+        }
+
+        while (SDLNet_UDP_Recv(g_udp_socket, packet) > 0) {
+            handle_packet(packet);
+        }
+    }
+
+    SDLNet_FreePacket(packet);
+    SDLNet_FreeSocketSet(socket_set);
+    return 0;
+}
+
+bool network_start(UDPsocket udp_socket, TcpStream* server_stream, const InitialGameState* initial_game_state) {
+    g_udp_socket = udp_socket;
+    g_server_stream = *server_stream;
+    g_world_layers = initial_game_state->world_layers;
+    g_world_width = initial_game_state->world_width;
+    g_world_height = initial_game_state->world_height;
+    if (!spsc_queue_init(&g_snapshot_queue, sizeof(int), SNAPSHOT_QUEUE_CAPACITY)) {
+        tcp_stream_free(&g_server_stream);
+        return false;
+    }
+    if (!spsc_queue_init(&g_free_snapshot_slots, sizeof(int), SNAPSHOT_QUEUE_CAPACITY)) {
+        spsc_queue_free(&g_snapshot_queue);
+        tcp_stream_free(&g_server_stream);
+        return false;
+    }
+    for (int slot = 0; slot < SNAPSHOT_QUEUE_CAPACITY; slot++) {
+        spsc_queue_push(&g_free_snapshot_slots, &slot);
+    }
+    if (!spsc_queue_init(&g_chunk_queue, sizeof(ReceivedChunk), initial_game_state->world_chunk_count + 1)) {
+        spsc_queue_free(&g_snapshot_queue);
+        spsc_queue_free(&g_free_snapshot_slots);
+        tcp_stream_free(&g_server_stream);
+        return false;
+    }
+    if (!spsc_queue_init(&g_visibility_queue, sizeof(Visibility), 1)) {
+        spsc_queue_free(&g_snapshot_queue);
+        spsc_queue_free(&g_free_snapshot_slots);
+        spsc_queue_free(&g_chunk_queue);
+        tcp_stream_free(&g_server_stream);
+        return false;
+    }
+    SDL_AtomicSet(&g_running, 1);
+    SDL_AtomicSet(&g_connected, 1);
+    SDL_AtomicSet(&g_snapshot_ack, 0);
+    SnapshotHeader no_snapshot = { 0 };
+    snapshot_assembly_begin(&g_assembly, &no_snapshot);
+    SDL_AtomicSet(&g_dropped_snapshots, 0);
+
+    g_thread = SDL_CreateThread(network_thread, "NetworkThread", NULL);
+    if (g_thread == NULL) {
+        printf("Failed to create network thread: %s\n", SDL_GetError());
+        spsc_queue_free(&g_snapshot_queue);
+        spsc_queue_free(&g_free_snapshot_slots);
+        spsc_queue_free(&g_chunk_queue);
+        spsc_queue_free(&g_visibility_queue);
+        tcp_stream_free(&g_server_stream);
+        return false;
+    }
+    return true;
+}
+
+void network_stop() {
+    if (g_thread == NULL) {
+        return;
+    }
+    SDL_AtomicSet(&g_running, 0);
+    SDL_WaitThread(g_thread, NULL);
+    g_thread = NULL;
+    spsc_queue_free(&g_snapshot_queue);
+    spsc_queue_free(&g_free_snapshot_slots);
+
+    ReceivedChunk received;
+    while (spsc_queue_pop(&g_chunk_queue, &received)) {
+        free(received.chunk);
+    }
+    spsc_queue_free(&g_chunk_queue);
+
+    Visibility visibility;
+    while (spsc_queue_pop(&g_visibility_queue, &visibility)) {
+        visibility_free(&visibility);
+    }
+    spsc_queue_free(&g_visibility_queue);
+    tcp_stream_free(&g_server_stream);
+}
+
+bool network_poll_snapshot(ReceivedSnapshot* out_received) {
+    int slot;
+    if (!spsc_queue_pop(&g_snapshot_queue, &slot)) {
+        return false;
+    }
+    const ReceivedSnapshot* received = &g_snapshot_slots[slot];
+    snapshot_copy(&out_received->snapshot, &received->snapshot);
+    out_received->input_ack = received->input_ack;
+    out_received->receive_time = received->receive_time;
+    spsc_queue_push(&g_free_snapshot_slots, &slot);
+    return true;
+}
+
+bool network_poll_world_chunk(ReceivedChunk* out_received) {
+    return spsc_queue_pop(&g_chunk_queue, out_received);
+}
+
+bool network_poll_world_visibility(Visibility* out_visibility) {
+    return spsc_queue_pop(&g_visibility_queue, out_visibility);
+}
+
+Uint32 network_get_snapshot_ack() {
+    return (Uint32)SDL_AtomicGet(&g_snapshot_ack);
+}
+
+bool network_is_connected() {
+    return SDL_AtomicGet(&g_connected) != 0;
+}
+
+int network_get_dropped_snapshots() {
+    return SDL_AtomicGet(&g_dropped_snapshots);
+}
@@ -0,0 +1,35 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include <stdbool.h>
+#include <SDL2/SDL_net.h>
+#include "../shared/snapshot.h"
+#include "../shared/protocol.h"
+#include "../shared/tcp_stream.h"
+
+typedef struct ReceivedSnapshot {
+    Snapshot snapshot;
+    Uint32 input_ack;     // Newest input the server had applied for us in this snapshot
+    double receive_time;
+} ReceivedSnapshot;
+
+// A decoded chunk of the world, owned by whoever pops it
+typedef struct ReceivedChunk {
+    int chunk_x;
+    int chunk_y;
+    Chunk* chunk;
+} ReceivedChunk;
+
+// Receives and decodes snapshots and the rest of the world on a background thread so the render loop
+// never waits on the network. Takes over the server stream along with anything already buffered in it.
+bool network_start(UDPsocket udp_socket, TcpStream* server_stream, const InitialGameState* initial_game_state);
+void network_stop();
+bool network_poll_snapshot(ReceivedSnapshot* out_received);
+bool network_poll_world_chunk(ReceivedChunk* out_received);
+// The world's visibility table once it has arrived, owned by whoever pops it
+bool network_poll_world_visibility(Visibility* out_visibility);
+Uint32 network_get_snapshot_ack();
+bool network_is_connected();
+int network_get_dropped_snapshots();
+
+#endif // NETWORK_H
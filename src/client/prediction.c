@@ -0,0 +1,40 @@
+#include <math.h>
+#include <string.h>
+
+#include "prediction.h"
+#include "../shared/movement.h"
+
+void prediction_init(Prediction* prediction, int tick_rate) {
+    memset(prediction, 0, sizeof(*prediction));
+    prediction->max_movement_time = get_max_movement_time(1.0f / tick_rate);
+}
+
+void prediction_add_input(Prediction* prediction, World* world, const InputState* input_state) {
+    // The server spends each input's time out of a budget that refills with its ticks. Our inputs cover the time
+    // between frames, so the budget is full again by the next one and only an input longer than the whole
+    // budget, like a frame hitch, is cut short. Keep the same time here so the replay matches the server.
+    InputState* input = &prediction->inputs[input_state->sequence % PREDICTION_BUFFER_SIZE];
+    *input = *input_state;
+    input->delta_time = fminf(input->delta_time, prediction->max_movement_time);
+    prediction->newest_sequence = input_state->sequence;
+
+    // Nothing to predict from until the server has told us where we are
+    if (prediction->has_player) {
+        InputState applied = *input;
+        apply_player_movement(&prediction->player, world, &applied);
+    }
+}
+
+void prediction_reconcile(Prediction* prediction, World* world, const Player* server_player, Uint32 input_ack) {
+    // Start over from the authoritative state and replay everything the server hasn't seen yet
+    prediction->player = *server_player;
+    prediction->has_player = true;
+
+    if (prediction->newest_sequence - input_ack >= PREDICTION_BUFFER_SIZE) {
+        return; // Too far behind to replay, take the server's word for it
+    }
+    for (Uint32 sequence = input_ack + 1; sequence <= prediction->newest_sequence; sequence++) {
+        InputState input = prediction->inputs[sequence % PREDICTION_BUFFER_SIZE];
+        apply_player_movement(&prediction->player, world, &input);
+    }
+}
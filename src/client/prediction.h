@@ -0,0 +1,22 @@
+#ifndef PREDICTION_H
+#define PREDICTION_H
+
+#include <stdbool.h>
+#include "../shared/game.h"
+
+#define PREDICTION_BUFFER_SIZE 128
+
+// Local player state run ahead of the server using the shared movement code
+typedef struct Prediction {
+    bool has_player;
+    Player player;
+    Uint32 newest_sequence;
+    float max_movement_time; // Longest input the server will apply in full, see get_max_movement_time
+    InputState inputs[PREDICTION_BUFFER_SIZE]; // Ring indexed by sequence, covers inputs the server hasn't applied yet
+} Prediction;
+
+void prediction_init(Prediction* prediction, int tick_rate);
+void prediction_add_input(Prediction* prediction, World* world, const InputState* input_state);
+void prediction_reconcile(Prediction* prediction, World* world, const Player* server_player, Uint32 input_ack);
+
+#endif // PREDICTION_H
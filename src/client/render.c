@@ -7,11 +7,18 @@
 
 #include "render.h"
 #include "texture.h"
+#include "world_mesh.h"
 #include "../shared/game.h"
 #include "../shared/settings.h"
 #include "../shared/vector.h"
 #include "../shared/utils.h"
 
+#define WORLD_FIELD_OF_VIEW 90.0f
+#define WORLD_NEAR_PLANE 0.01f
+#define WORLD_FAR_PLANE 500.0f
+
+static Frustum get_view_frustum(vec3 eye, vec3 target, float aspect, float far_plane);
+
 void init_opengl() {
     // Set swap interval for Vsync
     SDL_GL_SetSwapInterval(1);
@@ -166,30 +173,38 @@ void render_player_texture(Player* player, GLuint texture) {
     glEnd();
 }
 
-void render_players(Player* players, int current_player, int players_count, GLuint texture) {
-    for (int i = 0; i < players_count; i++) {
-        if (i == current_player) {
+void render_players(GameState* game_state, int current_player, GLuint texture) {
+    for (int i = 0; i < game_state->player_pool.count; i++) {
+        Player* player = &game_state->players[game_state->player_pool.dense[i]];
+        if (player->id == current_player) {
             continue;
         }
-        if (players[i].death_timer <= 0.0f) {
-            render_player_texture(&players[i], texture);
+        if (player->death_timer <= 0.0f) {
+            render_player_texture(player, texture);
         }
     }
 }
 
 void render_world(World* world, Player* player, GLuint test_texture) {
+    // The view distance moves the far plane in, so culling against the frustum also drops distant chunks
+    float view_distance = get_setting_float("view_distance");
+    float far_plane = view_distance > 0.0f ? view_distance : WORLD_FAR_PLANE;
+    float aspect = (float)get_setting_int("screen_width") / (float)get_setting_int("screen_height");
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
-    gluPerspective(90.0, (double)get_setting_int("screen_width") / (double)get_setting_int("screen_height"), 0.01, 500.0);
+    gluPerspective(WORLD_FIELD_OF_VIEW, aspect, WORLD_NEAR_PLANE, far_plane);
 
+    vec3 target = {
+        player->position.x + cosf(player->yaw),
+        player->position.y + sinf(player->yaw),
+        player->position.z - sinf(player->pitch)
+    };
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
     gluLookAt(player->position.x, player->position.y, player->position.z,
-            player->position.x + cosf(player->yaw), player->position.y + sinf(player->yaw), player->position.z - sinf(player->pitch),
+            target.x, target.y, target.z,
             0.0f, 0.0f, -1.0f);
 
-    Direction neighbor_dirs[] = {DIR_EAST, DIR_WEST, DIR_SOUTH, DIR_NORTH};
-
     if (test_texture != 0) {
         render_face(-4, -4, 0, CELL_XY_SCALE, CELL_XY_SCALE, DIR_UP, test_texture);
         render_face(-4, -4, 0, CELL_XY_SCALE, CELL_XY_SCALE, DIR_DOWN, test_texture);
@@ -198,66 +213,67 @@ void render_world(World* world, Player* player, GLuint test_texture) {
         render_face(-4, -4, 0, CELL_XY_SCALE, CELL_Z_SCALE, DIR_EAST, test_texture);
     }
 
-    for (int z = 0; z < world->num_layers; z++) {
-        Layer* layer = &world->layers[z];
-        for (int y = 0; y < layer->height; ++y) {
-            for (int x = 0; x < layer->width; ++x) {
-                Cell* cell = &layer->cells[y][x];
-                Cell* neighbors[4] = {
-                    get_cell(layer, x + 1, y + 0),
-                    get_cell(layer, x -1, y + 0),
-                    get_cell(layer, x + 0, y + 1),
-                    get_cell(layer, x + 0, y - 1)
-                };
-                TextureInfo* cell_texture_info = get_texture_info(cell->color);
-
-                // Render floors
-                if (cell->type != CELL_VOID) {
-                    render_face(x * CELL_XY_SCALE, y * CELL_XY_SCALE, z * CELL_Z_SCALE, CELL_XY_SCALE, CELL_XY_SCALE, DIR_DOWN, cell_texture_info->floor_texture);
-                }
-
-                // Render ceilings
-                if (cell->type == CELL_SOLID || cell->type == CELL_ROOM) {
-                    render_face(x * CELL_XY_SCALE, y * CELL_XY_SCALE, z * CELL_Z_SCALE, CELL_XY_SCALE, CELL_XY_SCALE, DIR_UP, cell_texture_info->ceiling_texture);
-                }
-                
-                for (int i = 0; i < 4; ++i) {
-                    Cell* neighbor = neighbors[i];
-                    // Get texture info for the neighboring cell
-                    TextureInfo* neighbor_texture_info = neighbor ? get_texture_info(neighbor->color) : NULL;
-
-                    if (cell->type != CELL_SOLID && neighbor != NULL && neighbor->type == CELL_SOLID) {
-                        if (neighbor && !neighbor_texture_info) {
-                            printf("Failed to find texture for color: r=%d, g=%d, b=%d\n",
-                                neighbor->color.r, neighbor->color.g, neighbor->color.b);
-                            continue;
-                        }
-                        //Render walls for adjacent solid blocks
-                        render_face(x * CELL_XY_SCALE, y * CELL_XY_SCALE, z * CELL_Z_SCALE, CELL_XY_SCALE, CELL_Z_SCALE, neighbor_dirs[i], neighbor_texture_info->wall_texture);
-
-                    } else if (cell->type == CELL_SOLID) {
-                        //Render walls at the world edge
-                        if (neighbor == NULL) {
-                            GLuint wall_texture = cell_texture_info->wall_texture;
-                            render_face(x * CELL_XY_SCALE, y * CELL_XY_SCALE, z * CELL_Z_SCALE, CELL_XY_SCALE, CELL_Z_SCALE, neighbor_dirs[i], wall_texture);
-                        }
-                    }
-                }
-            }
+    // The world geometry is baked into vertex buffers, see world_mesh.h
+    Frustum frustum = get_view_frustum(player->position, target, aspect, far_plane);
+    render_world_mesh(&frustum, &world->visibility);
+}
+
+bool is_box_in_frustum(const Frustum* frustum, vec3 min, vec3 max) {
+    for (int i = 0; i < 6; i++) {
+        // The corner furthest along the plane normal, if even that is outside the whole box is
+        vec3 normal = frustum->normals[i];
+        vec3 corner = {
+            normal.x >= 0.0f ? max.x : min.x,
+            normal.y >= 0.0f ? max.y : min.y,
+            normal.z >= 0.0f ? max.z : min.z
+        };
+        if (vec3_dot(normal, corner) + frustum->offsets[i] < 0.0f) {
+            return false;
         }
     }
+    return true;
 }
 
-void render_projectile(Projectile* projectile, GLuint texture) {
+// The frustum gluPerspective and gluLookAt set up in render_world
+static Frustum get_view_frustum(vec3 eye, vec3 target, float aspect, float far_plane) {
+    vec3 up = {0.0f, 0.0f, -1.0f};
+    vec3 forward = vec3_normalize(vec3_subtract(target, eye));
+    vec3 side;
+    vec3_cross(&forward, &up, &side);
+    side = vec3_normalize(side);
+    vec3 camera_up;
+    vec3_cross(&side, &forward, &camera_up);
+
+    float tan_y = tanf(WORLD_FIELD_OF_VIEW * 0.5f * (float)M_PI / 180.0f);
+    float tan_x = tan_y * aspect;
+    Frustum frustum;
+    frustum.normals[0] = forward;
+    frustum.normals[1] = vec3_multiply_scalar(forward, -1.0f);
+    frustum.normals[2] = vec3_add(vec3_multiply_scalar(forward, tan_x), side);
+    frustum.normals[3] = vec3_subtract(vec3_multiply_scalar(forward, tan_x), side);
+    frustum.normals[4] = vec3_add(vec3_multiply_scalar(forward, tan_y), camera_up);
+    frustum.normals[5] = vec3_subtract(vec3_multiply_scalar(forward, tan_y), camera_up);
+    for (int i = 0; i < 6; i++) {
+        frustum.offsets[i] = -vec3_dot(frustum.normals[i], eye);
+    }
+    frustum.offsets[0] -= WORLD_NEAR_PLANE;
+    frustum.offsets[1] += far_plane;
+    // The far corners are the points furthest from the eye
+    frustum.eye = eye;
+    frustum.radius = far_plane * sqrtf(1.0f + tan_x * tan_x + tan_y * tan_y);
+    return frustum;
+}
+
+void render_projectile(vec3 position, float size, GLuint texture) {
     glPushMatrix();
-    glTranslatef(projectile->position.x, projectile->position.y, projectile->position.z);
+    glTranslatef(position.x, position.y, position.z);
 
     glBindTexture(GL_TEXTURE_2D, texture);
     glBegin(GL_QUADS);
-        glTexCoord2f(0.0f, 0.0f); glVertex3f(-projectile->size / 2, -projectile->size / 2, 0.0f);
-        glTexCoord2f(1.0f, 0.0f); glVertex3f( projectile->size / 2, -projectile->size / 2, 0.0f);
-        glTexCoord2f(1.0f, 1.0f); glVertex3f( projectile->size / 2,  projectile->size / 2, 0.0f);
-        glTexCoord2f(0.0f, 1.0f); glVertex3f(-projectile->size / 2,  projectile->size / 2, 0.0f);
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(-size / 2, -size / 2, 0.0f);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f( size / 2, -size / 2, 0.0f);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f( size / 2,  size / 2, 0.0f);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(-size / 2,  size / 2, 0.0f);
     glEnd();
 
     glBindTexture(GL_TEXTURE_2D, 0);
@@ -265,11 +281,10 @@ void render_projectile(Projectile* projectile, GLuint texture) {
 }
 
 void render_projectiles(GameState* game_state, GLuint projectile_texture) {
-    for (int i = 0; i < MAX_PROJECTILES; i++) {
-        Projectile* projectile = &game_state->projectiles[i];
-        if (projectile->ttl > 0) {
-            render_projectile(projectile, projectile_texture);
-        }
+    Projectiles* projectiles = &game_state->projectiles;
+    for (int i = 0; i < game_state->projectile_pool.count; i++) {
+        vec3 position = { projectiles->x[i], projectiles->y[i], projectiles->z[i] };
+        render_projectile(position, projectiles->size[i], projectile_texture);
     }
 }
 
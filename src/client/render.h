@@ -5,6 +5,7 @@
 #include <SDL2/SDL_image.h>
 #include "client.h"
 #include "../shared/game.h"
+#include "../shared/vector.h"
 
 typedef enum {
     DIR_EAST,
@@ -15,11 +16,20 @@ typedef enum {
     DIR_UP,
 } Direction;
 
+// Six planes facing inward, a point p is inside when dot(normals[i], p) + offsets[i] >= 0 for all of them
+typedef struct Frustum {
+    vec3 normals[6];
+    float offsets[6];
+    vec3 eye;
+    float radius; // Nothing inside is further than this from the eye
+} Frustum;
+
 void init_opengl();
 void render_ui_elements(int health, GLuint health_icon_texture);
 void render_face(float x, float y, float z, float width, float height, Direction direction, GLuint texture);
 void render_world(World* world, Player* player, GLuint test_texture);
-void render_players(Player* player, int current_player, int players_count, GLuint texture);
+bool is_box_in_frustum(const Frustum* frustum, vec3 min, vec3 max);
+void render_players(GameState* game_state, int current_player, GLuint texture);
 
 GLuint load_texture(const char* filename);
 GLuint create_texture(SDL_Surface* image, int x, int y, int width, int height);
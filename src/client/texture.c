@@ -5,43 +5,33 @@
 #include <SDL2/SDL_opengl.h>
 
 #include "texture.h"
+#include "../shared/cell_definitions.h"
 
-#define HASH_TABLE_SIZE 256
+// Indexed like the cell definitions, every textured face samples the one atlas texture
+static TextureInfo texture_infos[MAX_CELL_DEFINITIONS];
+static GLuint atlas_texture = 0;
+static int atlas_width = 0;
+static int atlas_height = 0;
 
-static TextureNode* hash_table[HASH_TABLE_SIZE] = {0};
-static SDL_Surface* texture_atlas = NULL;
-static TextureInfo default_cell;
+static TextureRegion get_atlas_region(SDL_Rect rect);
 
-static unsigned int color_hash(SDL_Color color);
-static void add_texture_info(SDL_Color color, TextureInfo info);
-static int load_cell_definitions(const char* line);
-
-void init_texture_handler(const char* cell_definitions_path, SDL_Surface* atlas) {
-    texture_atlas = atlas;
-
-    FILE* file = fopen(cell_definitions_path, "r");
-    if (!file) {
-        printf("Error: Could not open cell definitions file: %s\n", cell_definitions_path);
-        return;
+bool init_texture_handler(SDL_Surface* atlas) {
+    memset(texture_infos, 0, sizeof(texture_infos));
+    if (!atlas) {
+        printf("Error: No texture atlas to map the cell definitions into.\n");
+        return false;
     }
-
-    char line[256];
-    while (fgets(line, sizeof(line), file)) {
-        if (line[0] == '#' || line[0] == '\n') {
-            continue; // Skip comments and empty lines
-        }
-
-        if (!load_cell_definitions(line)) {
-            printf("Error: Invalid cell definition: %s\n", line);
-        }
+    atlas_texture = create_texture(atlas, 0, 0, atlas->w, atlas->h);
+    atlas_width = atlas->w;
+    atlas_height = atlas->h;
+    for (int i = 1; i < get_cell_definition_count(); i++) {
+        const CellDefinition* definition = get_cell_definition((Cell) { (Uint8)i });
+        texture_infos[i].ceiling = get_atlas_region(definition->ceiling);
+        texture_infos[i].floor = get_atlas_region(definition->floor);
+        texture_infos[i].wall = get_atlas_region(definition->wall);
+        printf("Loaded cell definition: %s\n", definition->name);
     }
-
-    fclose(file);
-    default_cell = (TextureInfo) {
-        .ceiling_texture = 0,
-        .floor_texture = 0,
-        .wall_texture = 0
-    };
+    return true;
 }
 
 GLuint create_texture(SDL_Surface* image, int x, int y, int width, int height) {
@@ -79,85 +69,26 @@ GLuint create_texture(SDL_Surface* image, int x, int y, int width, int height) {
     return texture;
 }
 
-static int hash(SDL_Color color) {
-    return (color.r ^ color.g ^ color.b) % HASH_TABLE_SIZE;
-}
-
-static void add_texture_info(SDL_Color color, TextureInfo info) {
-    int index = hash(color);
-    color.a = 0;
-    TextureNode* new_node = (TextureNode*)malloc(sizeof(TextureNode));
-    new_node->color = color;
-    new_node->texture_info = info;
-    new_node->next = hash_table[index];
-    hash_table[index] = new_node;
-}
-
-TextureInfo* get_texture_info(SDL_Color color) {
-    color.a = 0;
-    if (color.r == 0 && color.g == 255 && color.b == 255) {
-        return &default_cell;
-    }
-    int index = hash(color);
-    TextureNode* node = hash_table[index];
-
-    while (node) {
-        if (SDL_memcmp(&color, &node->color, sizeof(SDL_Color)) == 0) {
-            return &node->texture_info;
-        }
-        node = node->next;
-    }
-
-    return NULL;
+TextureInfo* get_texture_info(Cell cell) {
+    return &texture_infos[cell.definition];
 }
 
 void free_texture_handler() {
-    for (int i = 0; i < HASH_TABLE_SIZE; ++i) {
-        TextureNode* node = hash_table[i];
-        while (node) {
-            TextureNode* next_node = node->next;
-            free(node);
-            node = next_node;
-        }
-    }
-}
-
-unsigned int color_hash(SDL_Color color) {
-    return (color.r * 31 + color.g) * 31 + color.b;
+    glDeleteTextures(1, &atlas_texture);
+    atlas_texture = 0;
+    memset(texture_infos, 0, sizeof(texture_infos));
 }
 
-static int load_cell_definitions(const char* line) {
-    unsigned int r, g, b;
-    char type_str[32];
-    char c_str[32], f_str[32], w_str[32], name_str[64];
-    int cx, cy, cw, ch, fx, fy, fw, fh, wx, wy, ww, wh;
-
-    int num_parsed = sscanf(line, " %02X%02X%02X %31s %31s %31s %31s %255[^\n]",
-                            &r, &g, &b,
-                            type_str,
-                            c_str,
-                            f_str,
-                            w_str,
-                            name_str);
-
-    if (num_parsed == 8) {
-        SDL_Color color = {(Uint8)r, (Uint8)g, (Uint8)b, 255};
-
-        sscanf(c_str, "%d,%d,%d,%d", &cx, &cy, &cw, &ch);
-        sscanf(f_str, "%d,%d,%d,%d", &fx, &fy, &fw, &fh);
-        sscanf(w_str, "%d,%d,%d,%d", &wx, &wy, &ww, &wh);
-
-        TextureInfo info;
-        info.ceiling_texture = create_texture(texture_atlas, cx, cy, cw, ch);
-        info.floor_texture = create_texture(texture_atlas, fx, fy, fw, fh);
-        info.wall_texture = create_texture(texture_atlas, wx, wy, ww, wh);
-
-        add_texture_info(color, info);
-
-        printf("Loaded cell definition: %s\n", name_str);
-        return 1;
+static TextureRegion get_atlas_region(SDL_Rect rect) {
+    if (atlas_texture == 0 || rect.w <= 0 || rect.h <= 0) {
+        return (TextureRegion) {0};
     }
-
-    printf("Error: Invalid cell definition line: %s\n", line);
-    return 0;
+    // Sample from texel centers so linear filtering never picks up the neighboring region
+    return (TextureRegion) {
+        .texture = atlas_texture,
+        .u0 = (rect.x + 0.5f) / atlas_width,
+        .v0 = (rect.y + 0.5f) / atlas_height,
+        .u1 = (rect.x + rect.w - 0.5f) / atlas_width,
+        .v1 = (rect.y + rect.h - 0.5f) / atlas_height
+    };
 }
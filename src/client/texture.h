@@ -2,21 +2,24 @@
 #define TEXTURE_HANDLER_H
 
 #include <SDL2/SDL.h>
+#include "../shared/game.h"
+
+// A rectangle of the cell texture atlas. Texture is 0 for faces without one, which are drawn untextured.
+typedef struct TextureRegion {
+    GLuint texture;
+    float u0, v0, u1, v1;
+} TextureRegion;
 
 typedef struct TextureInfo {
-    GLuint floor_texture;
-    GLuint ceiling_texture;
-    GLuint wall_texture;
+    TextureRegion floor;
+    TextureRegion ceiling;
+    TextureRegion wall;
 } TextureInfo;
 
-typedef struct TextureNode {
-    SDL_Color color;
-    TextureInfo texture_info;
-    struct TextureNode* next;
-} TextureNode;
-
-void init_texture_handler(const char* cell_definitions_path, SDL_Surface* atlas);
-TextureInfo* get_texture_info(SDL_Color color);
+// Uploads the atlas once and maps every loaded cell definition into it, see load_cell_definitions.
+// False if there is no atlas to upload.
+bool init_texture_handler(SDL_Surface* atlas);
+TextureInfo* get_texture_info(Cell cell);
 void free_texture_handler();
 GLuint create_texture(SDL_Surface* image, int x, int y, int width, int height);
 
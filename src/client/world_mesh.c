@@ -0,0 +1,564 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_opengl.h>
+
+#include "world_mesh.h"
+#include "render.h"
+#include "texture.h"
+#include "../shared/utils.h"
+#include "../shared/chunk.h"
+#include "../shared/cell_definitions.h"
+#include "../shared/visibility.h"
+
+// Texture coordinates count cells so merged faces repeat their atlas region, which is u, v, width, height
+typedef struct WorldVertex {
+    float u, v;
+    float x, y, z;
+    float region[4];
+} WorldVertex;
+
+typedef struct WorldFace {
+    GLuint texture;
+    WorldVertex vertices[4];
+} WorldFace;
+
+// Quads [first, first + count) of a chunk's buffer all use one texture
+typedef struct MeshRange {
+    GLuint texture;
+    int first;
+    int count;
+} MeshRange;
+
+typedef struct ChunkMesh {
+    GLuint buffer; // 0 until the chunk has something to draw
+    vec3 bounds_min;
+    vec3 bounds_max;
+    MeshRange* ranges;
+    int range_count;
+    bool dirty;
+} ChunkMesh;
+
+// Buffer objects and shaders are not part of the OpenGL 1.1 that Windows exports, so they are looked up at runtime
+static PFNGLGENBUFFERSPROC gl_gen_buffers;
+static PFNGLBINDBUFFERPROC gl_bind_buffer;
+static PFNGLBUFFERDATAPROC gl_buffer_data;
+static PFNGLDELETEBUFFERSPROC gl_delete_buffers;
+static PFNGLCREATESHADERPROC gl_create_shader;
+static PFNGLSHADERSOURCEPROC gl_shader_source;
+static PFNGLCOMPILESHADERPROC gl_compile_shader;
+static PFNGLGETSHADERIVPROC gl_get_shader_iv;
+static PFNGLGETSHADERINFOLOGPROC gl_get_shader_info_log;
+static PFNGLDELETESHADERPROC gl_delete_shader;
+static PFNGLCREATEPROGRAMPROC gl_create_program;
+static PFNGLATTACHSHADERPROC gl_attach_shader;
+static PFNGLBINDATTRIBLOCATIONPROC gl_bind_attrib_location;
+static PFNGLLINKPROGRAMPROC gl_link_program;
+static PFNGLGETPROGRAMIVPROC gl_get_program_iv;
+static PFNGLGETPROGRAMINFOLOGPROC gl_get_program_info_log;
+static PFNGLDELETEPROGRAMPROC gl_delete_program;
+static PFNGLUSEPROGRAMPROC gl_use_program;
+static PFNGLGETUNIFORMLOCATIONPROC gl_get_uniform_location;
+static PFNGLUNIFORM1IPROC gl_uniform_1i;
+static PFNGLENABLEVERTEXATTRIBARRAYPROC gl_enable_vertex_attrib_array;
+static PFNGLDISABLEVERTEXATTRIBARRAYPROC gl_disable_vertex_attrib_array;
+static PFNGLVERTEXATTRIBPOINTERPROC gl_vertex_attrib_pointer;
+
+// Location 1 is not aliased by any of the fixed function attributes
+#define REGION_ATTRIBUTE 1
+
+// Wraps the cell coordinates into the face's atlas region, which GL_REPEAT can only do for a whole texture.
+// Faces without a texture have an empty region and keep the vertex color like untextured fixed function quads.
+static const char* world_vertex_shader =
+    "#version 120\n"
+    "attribute vec4 region;\n"
+    "varying vec2 cell_uv;\n"
+    "varying vec4 atlas_region;\n"
+    "void main() {\n"
+    "    cell_uv = gl_MultiTexCoord0.st;\n"
+    "    atlas_region = region;\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+static const char* world_fragment_shader =
+    "#version 120\n"
+    "uniform sampler2D atlas;\n"
+    "varying vec2 cell_uv;\n"
+    "varying vec4 atlas_region;\n"
+    "void main() {\n"
+    "    if (atlas_region.z == 0.0) {\n"
+    "        gl_FragColor = gl_Color;\n"
+    "        return;\n"
+    "    }\n"
+    "    gl_FragColor = gl_Color * texture2D(atlas, atlas_region.xy + fract(cell_uv) * atlas_region.zw);\n"
+    "}\n";
+static GLuint world_program = 0;
+
+static ChunkMesh* chunk_meshes = NULL;
+static int mesh_chunks_x = 0;
+static int mesh_chunks_y = 0;
+
+// Scratch space reused by every chunk build
+static WorldFace* faces = NULL;
+static int face_count = 0;
+static int face_capacity = 0;
+static WorldVertex* vertices = NULL;
+static int vertex_capacity = 0;
+
+static bool load_gl_functions();
+static GLuint compile_shader(GLenum type, const char* source);
+static GLuint create_world_program();
+static void build_chunk_mesh(World* world, int chunk_x, int chunk_y, ChunkMesh* mesh);
+static bool add_layer_faces(World* world, Chunk* chunk, int chunk_x, int chunk_y, int z);
+static bool add_merged_faces(const TextureRegion* mask[CHUNK_COLUMNS], int x, int y, int z, Direction direction, bool merge_x, bool merge_y);
+static bool same_region(const TextureRegion* a, const TextureRegion* b);
+static bool add_face(int x, int y, int z, int size_x, int size_y, Direction direction, const TextureRegion* region);
+static void free_chunk_mesh(ChunkMesh* mesh);
+static int compare_faces(const void* a, const void* b);
+
+bool init_world_mesh(World* world) {
+    if (!load_gl_functions()) {
+        printf("Error: OpenGL vertex buffer objects and shaders are not supported.\n");
+        return false;
+    }
+    world_program = create_world_program();
+    if (world_program == 0) {
+        return false;
+    }
+
+    chunk_meshes = calloc(world->chunks_x * world->chunks_y > 0 ? world->chunks_x * world->chunks_y : 1, sizeof(ChunkMesh));
+    if (!chunk_meshes) {
+        printf("Error: Failed to allocate world mesh.\n");
+        return false;
+    }
+    mesh_chunks_x = world->chunks_x;
+    mesh_chunks_y = world->chunks_y;
+    return true;
+}
+
+void invalidate_world_mesh_chunk(int chunk_x, int chunk_y) {
+    int offsets[5][2] = { {0, 0}, {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+    for (int i = 0; i < 5; i++) {
+        int x = chunk_x + offsets[i][0];
+        int y = chunk_y + offsets[i][1];
+        if (x >= 0 && y >= 0 && x < mesh_chunks_x && y < mesh_chunks_y) {
+            chunk_meshes[y * mesh_chunks_x + x].dirty = true;
+        }
+    }
+}
+
+void update_world_mesh(World* world) {
+    for (int chunk_y = 0; chunk_y < mesh_chunks_y; chunk_y++) {
+        for (int chunk_x = 0; chunk_x < mesh_chunks_x; chunk_x++) {
+            ChunkMesh* mesh = &chunk_meshes[chunk_y * mesh_chunks_x + chunk_x];
+            if (mesh->dirty) {
+                build_chunk_mesh(world, chunk_x, chunk_y, mesh);
+                mesh->dirty = false;
+            }
+        }
+    }
+}
+
+void render_world_mesh(const Frustum* frustum, const Visibility* visibility) {
+    // Chunks outside the square around the frustum's reach can't be visible, so the cost of culling
+    // follows the view distance rather than the size of the map
+    float chunk_extent = CHUNK_SIZE * CELL_XY_SCALE;
+    int first_x = MAX(0, (int)floorf((frustum->eye.x - frustum->radius) / chunk_extent));
+    int first_y = MAX(0, (int)floorf((frustum->eye.y - frustum->radius) / chunk_extent));
+    int last_x = (int)floorf((frustum->eye.x + frustum->radius) / chunk_extent);
+    int last_y = (int)floorf((frustum->eye.y + frustum->radius) / chunk_extent);
+    last_x = last_x < mesh_chunks_x ? last_x : mesh_chunks_x - 1;
+    last_y = last_y < mesh_chunks_y ? last_y : mesh_chunks_y - 1;
+    int eye_region = get_visibility_region(visibility, frustum->eye);
+
+    gl_use_program(world_program);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    gl_enable_vertex_attrib_array(REGION_ATTRIBUTE);
+    for (int chunk_y = first_y; chunk_y <= last_y; chunk_y++) {
+        for (int chunk_x = first_x; chunk_x <= last_x; chunk_x++) {
+            ChunkMesh* mesh = &chunk_meshes[chunk_y * mesh_chunks_x + chunk_x];
+            if (mesh->buffer == 0 || !is_chunk_visible(visibility, eye_region, chunk_x, chunk_y) ||
+                !is_box_in_frustum(frustum, mesh->bounds_min, mesh->bounds_max)) {
+                continue;
+            }
+            gl_bind_buffer(GL_ARRAY_BUFFER, mesh->buffer);
+            glTexCoordPointer(2, GL_FLOAT, sizeof(WorldVertex), (const void*)offsetof(WorldVertex, u));
+            glVertexPointer(3, GL_FLOAT, sizeof(WorldVertex), (const void*)offsetof(WorldVertex, x));
+            gl_vertex_attrib_pointer(REGION_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(WorldVertex), (const void*)offsetof(WorldVertex, region));
+            for (int r = 0; r < mesh->range_count; r++) {
+                glBindTexture(GL_TEXTURE_2D, mesh->ranges[r].texture);
+                glDrawArrays(GL_QUADS, mesh->ranges[r].first, mesh->ranges[r].count);
+            }
+        }
+    }
+    gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+    gl_disable_vertex_attrib_array(REGION_ATTRIBUTE);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    gl_use_program(0);
+}
+
+void free_world_mesh() {
+    for (int i = 0; i < mesh_chunks_x * mesh_chunks_y; i++) {
+        free_chunk_mesh(&chunk_meshes[i]);
+    }
+    free(chunk_meshes);
+    chunk_meshes = NULL;
+    mesh_chunks_x = 0;
+    mesh_chunks_y = 0;
+    if (world_program != 0) {
+        gl_delete_program(world_program);
+        world_program = 0;
+    }
+
+    free(faces);
+    faces = NULL;
+    face_count = 0;
+    face_capacity = 0;
+    free(vertices);
+    vertices = NULL;
+    vertex_capacity = 0;
+}
+
+static bool load_gl_functions() {
+    gl_gen_buffers = (PFNGLGENBUFFERSPROC)SDL_GL_GetProcAddress("glGenBuffers");
+    gl_bind_buffer = (PFNGLBINDBUFFERPROC)SDL_GL_GetProcAddress("glBindBuffer");
+    gl_buffer_data = (PFNGLBUFFERDATAPROC)SDL_GL_GetProcAddress("glBufferData");
+    gl_delete_buffers = (PFNGLDELETEBUFFERSPROC)SDL_GL_GetProcAddress("glDeleteBuffers");
+    gl_create_shader = (PFNGLCREATESHADERPROC)SDL_GL_GetProcAddress("glCreateShader");
+    gl_shader_source = (PFNGLSHADERSOURCEPROC)SDL_GL_GetProcAddress("glShaderSource");
+    gl_compile_shader = (PFNGLCOMPILESHADERPROC)SDL_GL_GetProcAddress("glCompileShader");
+    gl_get_shader_iv = (PFNGLGETSHADERIVPROC)SDL_GL_GetProcAddress("glGetShaderiv");
+    gl_get_shader_info_log = (PFNGLGETSHADERINFOLOGPROC)SDL_GL_GetProcAddress("glGetShaderInfoLog");
+    gl_delete_shader = (PFNGLDELETESHADERPROC)SDL_GL_GetProcAddress("glDeleteShader");
+    gl_create_program = (PFNGLCREATEPROGRAMPROC)SDL_GL_GetProcAddress("glCreateProgram");
+    gl_attach_shader = (PFNGLATTACHSHADERPROC)SDL_GL_GetProcAddress("glAttachShader");
+    gl_bind_attrib_location = (PFNGLBINDATTRIBLOCATIONPROC)SDL_GL_GetProcAddress("glBindAttribLocation");
+    gl_link_program = (PFNGLLINKPROGRAMPROC)SDL_GL_GetProcAddress("glLinkProgram");
+    gl_get_program_iv = (PFNGLGETPROGRAMIVPROC)SDL_GL_GetProcAddress("glGetProgramiv");
+    gl_get_program_info_log = (PFNGLGETPROGRAMINFOLOGPROC)SDL_GL_GetProcAddress("glGetProgramInfoLog");
+    gl_delete_program = (PFNGLDELETEPROGRAMPROC)SDL_GL_GetProcAddress("glDeleteProgram");
+    gl_use_program = (PFNGLUSEPROGRAMPROC)SDL_GL_GetProcAddress("glUseProgram");
+    gl_get_uniform_location = (PFNGLGETUNIFORMLOCATIONPROC)SDL_GL_GetProcAddress("glGetUniformLocation");
+    gl_uniform_1i = (PFNGLUNIFORM1IPROC)SDL_GL_GetProcAddress("glUniform1i");
+    gl_enable_vertex_attrib_array = (PFNGLENABLEVERTEXATTRIBARRAYPROC)SDL_GL_GetProcAddress("glEnableVertexAttribArray");
+    gl_disable_vertex_attrib_array = (PFNGLDISABLEVERTEXATTRIBARRAYPROC)SDL_GL_GetProcAddress("glDisableVertexAttribArray");
+    gl_vertex_attrib_pointer = (PFNGLVERTEXATTRIBPOINTERPROC)SDL_GL_GetProcAddress("glVertexAttribPointer");
+    return gl_gen_buffers && gl_bind_buffer && gl_buffer_data && gl_delete_buffers &&
+           gl_create_shader && gl_shader_source && gl_compile_shader && gl_get_shader_iv && gl_get_shader_info_log &&
+           gl_delete_shader && gl_create_program && gl_attach_shader && gl_bind_attrib_location && gl_link_program &&
+           gl_get_program_iv && gl_get_program_info_log && gl_delete_program && gl_use_program &&
+           gl_get_uniform_location && gl_uniform_1i && gl_enable_vertex_attrib_array &&
+           gl_disable_vertex_attrib_array && gl_vertex_attrib_pointer;
+}
+
+static GLuint compile_shader(GLenum type, const char* source) {
+    GLuint shader = gl_create_shader(type);
+    gl_shader_source(shader, 1, &source, NULL);
+    gl_compile_shader(shader);
+    GLint compiled = GL_FALSE;
+    gl_get_shader_iv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        char log[1024];
+        gl_get_shader_info_log(shader, sizeof(log), NULL, log);
+        printf("Error: Failed to compile world shader: %s\n", log);
+        gl_delete_shader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static GLuint create_world_program() {
+    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, world_vertex_shader);
+    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, world_fragment_shader);
+    if (vertex_shader == 0 || fragment_shader == 0) {
+        gl_delete_shader(vertex_shader);
+        gl_delete_shader(fragment_shader);
+        return 0;
+    }
+
+    GLuint program = gl_create_program();
+    gl_attach_shader(program, vertex_shader);
+    gl_attach_shader(program, fragment_shader);
+    gl_bind_attrib_location(program, REGION_ATTRIBUTE, "region");
+    gl_link_program(program);
+    // The program keeps the shaders alive for as long as it needs them
+    gl_delete_shader(vertex_shader);
+    gl_delete_shader(fragment_shader);
+
+    GLint linked = GL_FALSE;
+    gl_get_program_iv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        char log[1024];
+        gl_get_program_info_log(program, sizeof(log), NULL, log);
+        printf("Error: Failed to link world shader: %s\n", log);
+        gl_delete_program(program);
+        return 0;
+    }
+
+    gl_use_program(program);
+    gl_uniform_1i(gl_get_uniform_location(program, "atlas"), 0);
+    gl_use_program(0);
+    return program;
+}
+
+static void build_chunk_mesh(World* world, int chunk_x, int chunk_y, ChunkMesh* mesh) {
+    free_chunk_mesh(mesh);
+    Chunk* chunk = get_chunk(world, chunk_x, chunk_y);
+    if (!chunk) {
+        return;
+    }
+
+    face_count = 0;
+    for (int z = 0; z < world->num_layers; z++) {
+        if (!add_layer_faces(world, chunk, chunk_x, chunk_y, z)) {
+            printf("Error: Failed to allocate mesh of chunk %d,%d.\n", chunk_x, chunk_y);
+            return;
+        }
+    }
+    if (face_count == 0) {
+        return;
+    }
+
+    // Faces sharing a texture end up next to each other and are drawn with one call, with the atlas
+    // that is one call for the textured faces and one for any untextured ones
+    qsort(faces, face_count, sizeof(WorldFace), compare_faces);
+    int range_count = 1;
+    for (int i = 1; i < face_count; i++) {
+        if (faces[i].texture != faces[i - 1].texture) {
+            range_count++;
+        }
+    }
+    if (vertex_capacity < face_count * 4) {
+        WorldVertex* grown = realloc(vertices, face_count * 4 * sizeof(WorldVertex));
+        if (!grown) {
+            printf("Error: Failed to allocate mesh of chunk %d,%d.\n", chunk_x, chunk_y);
+            return;
+        }
+        vertices = grown;
+        vertex_capacity = face_count * 4;
+    }
+    mesh->ranges = malloc(range_count * sizeof(MeshRange));
+    if (!mesh->ranges) {
+        printf("Error: Failed to allocate mesh of chunk %d,%d.\n", chunk_x, chunk_y);
+        return;
+    }
+    mesh->bounds_min = (vec3) { faces[0].vertices[0].x, faces[0].vertices[0].y, faces[0].vertices[0].z };
+    mesh->bounds_max = mesh->bounds_min;
+    for (int i = 0; i < face_count; i++) {
+        memcpy(&vertices[i * 4], faces[i].vertices, sizeof(faces[i].vertices));
+        for (int j = 0; j < 4; j++) {
+            const WorldVertex* vertex = &faces[i].vertices[j];
+            mesh->bounds_min = (vec3) { fminf(mesh->bounds_min.x, vertex->x), fminf(mesh->bounds_min.y, vertex->y), fminf(mesh->bounds_min.z, vertex->z) };
+            mesh->bounds_max = (vec3) { fmaxf(mesh->bounds_max.x, vertex->x), fmaxf(mesh->bounds_max.y, vertex->y), fmaxf(mesh->bounds_max.z, vertex->z) };
+        }
+        if (i == 0 || faces[i].texture != faces[i - 1].texture) {
+            mesh->ranges[mesh->range_count++] = (MeshRange) { faces[i].texture, i * 4, 0 };
+        }
+        mesh->ranges[mesh->range_count - 1].count += 4;
+    }
+
+    gl_gen_buffers(1, &mesh->buffer);
+    gl_bind_buffer(GL_ARRAY_BUFFER, mesh->buffer);
+    gl_buffer_data(GL_ARRAY_BUFFER, face_count * 4 * sizeof(WorldVertex), vertices, GL_STATIC_DRAW);
+    gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+}
+
+static bool add_layer_faces(World* world, Chunk* chunk, int chunk_x, int chunk_y, int z) {
+    Direction neighbor_dirs[] = {DIR_EAST, DIR_WEST, DIR_SOUTH, DIR_NORTH};
+    int neighbor_offsets[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+    int base_x = chunk_x * CHUNK_SIZE;
+    int base_y = chunk_y * CHUNK_SIZE;
+
+    // Which region each face of the layer shows, by the cell that owns it
+    const TextureRegion* floors[CHUNK_COLUMNS] = {0};
+    const TextureRegion* ceilings[CHUNK_COLUMNS] = {0};
+    const TextureRegion* walls[4][CHUNK_COLUMNS] = {{0}};
+    const TextureRegion* edge_walls[4][CHUNK_COLUMNS] = {{0}};
+    for (int local_y = 0; local_y < CHUNK_SIZE; ++local_y) {
+        for (int local_x = 0; local_x < CHUNK_SIZE; ++local_x) {
+            Cell* cell = get_chunk_cell(chunk, z, local_x, local_y);
+            CellType type = get_cell_type(*cell);
+            if (type == CELL_VOID) {
+                continue;
+            }
+            TextureInfo* cell_texture_info = get_texture_info(*cell);
+            int index = local_y * CHUNK_SIZE + local_x;
+            floors[index] = &cell_texture_info->floor;
+            if (type == CELL_SOLID || type == CELL_ROOM) {
+                ceilings[index] = &cell_texture_info->ceiling;
+            }
+
+            // Walls belong to the solid side so empty chunks never need a mesh
+            if (type != CELL_SOLID) {
+                continue;
+            }
+            int x = base_x + local_x;
+            int y = base_y + local_y;
+            for (int i = 0; i < 4; ++i) {
+                // The cell that has this one as its neighbor in direction i, the wall is on its side
+                ivec3 facing_position = { x - neighbor_offsets[i][0], y - neighbor_offsets[i][1], z };
+                Cell* facing;
+                if (get_world_cell(world, facing_position, &facing) && get_cell_type(*facing) != CELL_SOLID) {
+                    walls[i][index] = &cell_texture_info->wall;
+                }
+
+                // Walls at the world edge are on this cell's side
+                ivec3 neighbor_position = { x + neighbor_offsets[i][0], y + neighbor_offsets[i][1], z };
+                Cell* neighbor;
+                if (!get_world_cell(world, neighbor_position, &neighbor)) {
+                    edge_walls[i][index] = &cell_texture_info->wall;
+                }
+            }
+        }
+    }
+
+    if (!add_merged_faces(floors, base_x, base_y, z, DIR_DOWN, true, true) ||
+        !add_merged_faces(ceilings, base_x, base_y, z, DIR_UP, true, true)) {
+        return false;
+    }
+    for (int i = 0; i < 4; ++i) {
+        // East and west walls run along y, south and north walls along x
+        bool along_y = neighbor_offsets[i][0] != 0;
+        if (!add_merged_faces(walls[i], base_x - neighbor_offsets[i][0], base_y - neighbor_offsets[i][1], z, neighbor_dirs[i], !along_y, along_y) ||
+            !add_merged_faces(edge_walls[i], base_x, base_y, z, neighbor_dirs[i], !along_y, along_y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Greedy meshing: each face grows along x while the region repeats, then along y while whole rows match.
+// The mask is cleared as faces take cells. Returns false if a face could not be stored.
+static bool add_merged_faces(const TextureRegion* mask[CHUNK_COLUMNS], int x, int y, int z, Direction direction, bool merge_x, bool merge_y) {
+    for (int local_y = 0; local_y < CHUNK_SIZE; ++local_y) {
+        for (int local_x = 0; local_x < CHUNK_SIZE; ++local_x) {
+            const TextureRegion* region = mask[local_y * CHUNK_SIZE + local_x];
+            if (!region) {
+                continue;
+            }
+            int size_x = 1;
+            while (merge_x && local_x + size_x < CHUNK_SIZE && same_region(mask[local_y * CHUNK_SIZE + local_x + size_x], region)) {
+                size_x++;
+            }
+            int size_y = 1;
+            bool row_matches = merge_y;
+            while (row_matches && local_y + size_y < CHUNK_SIZE) {
+                for (int i = 0; i < size_x && row_matches; i++) {
+                    row_matches = same_region(mask[(local_y + size_y) * CHUNK_SIZE + local_x + i], region);
+                }
+                if (row_matches) {
+                    size_y++;
+                }
+            }
+            for (int j = 0; j < size_y; j++) {
+                for (int i = 0; i < size_x; i++) {
+                    mask[(local_y + j) * CHUNK_SIZE + local_x + i] = NULL;
+                }
+            }
+            if (!add_face(x + local_x, y + local_y, z, size_x, size_y, direction, region)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Definitions often share atlas rects, their faces can merge too
+static bool same_region(const TextureRegion* a, const TextureRegion* b) {
+    return a == b || (a && b && a->texture == b->texture &&
+                      a->u0 == b->u0 && a->v0 == b->v0 && a->u1 == b->u1 && a->v1 == b->v1);
+}
+
+// Covers cells [x, x + size_x) x [y, y + size_y) of layer z, walls go on the given side of that area.
+// Same corners as render_face, with the texture coordinates counting cells so the region repeats.
+static bool add_face(int x, int y, int z, int size_x, int size_y, Direction direction, const TextureRegion* region) {
+    if (face_count == face_capacity) {
+        int capacity = face_capacity > 0 ? face_capacity * 2 : 1024;
+        WorldFace* grown = realloc(faces, capacity * sizeof(WorldFace));
+        if (!grown) {
+            return false;
+        }
+        faces = grown;
+        face_capacity = capacity;
+    }
+
+    float ceiling_offset = 0.01f;
+    float x0 = x * CELL_XY_SCALE, x1 = (x + size_x) * CELL_XY_SCALE;
+    float y0 = y * CELL_XY_SCALE, y1 = (y + size_y) * CELL_XY_SCALE;
+    float z0 = z * CELL_Z_SCALE, z1 = z0 + CELL_Z_SCALE;
+    // Cells along the texture's u and v axes
+    float u = size_x, v = size_y;
+    WorldFace* face = &faces[face_count++];
+    face->texture = region->texture;
+    WorldVertex* vertex = face->vertices;
+    switch (direction) {
+        case DIR_EAST:
+            u = size_y, v = 1;
+            vertex[0] = (WorldVertex) {0, 0, x1, y0, z0};
+            vertex[1] = (WorldVertex) {u, 0, x1, y1, z0};
+            vertex[2] = (WorldVertex) {u, v, x1, y1, z1};
+            vertex[3] = (WorldVertex) {0, v, x1, y0, z1};
+            break;
+        case DIR_DOWN:
+            vertex[0] = (WorldVertex) {0, 0, x0, y0, z1};
+            vertex[1] = (WorldVertex) {u, 0, x1, y0, z1};
+            vertex[2] = (WorldVertex) {u, v, x1, y1, z1};
+            vertex[3] = (WorldVertex) {0, v, x0, y1, z1};
+            break;
+        case DIR_WEST:
+            u = size_y, v = 1;
+            vertex[0] = (WorldVertex) {0, 0, x0, y0, z1};
+            vertex[1] = (WorldVertex) {u, 0, x0, y1, z1};
+            vertex[2] = (WorldVertex) {u, v, x0, y1, z0};
+            vertex[3] = (WorldVertex) {0, v, x0, y0, z0};
+            break;
+        case DIR_UP:
+            vertex[0] = (WorldVertex) {0, 0, x0, y0, z0 + ceiling_offset};
+            vertex[1] = (WorldVertex) {u, 0, x1, y0, z0 + ceiling_offset};
+            vertex[2] = (WorldVertex) {u, v, x1, y1, z0 + ceiling_offset};
+            vertex[3] = (WorldVertex) {0, v, x0, y1, z0 + ceiling_offset};
+            break;
+        case DIR_NORTH:
+            v = 1;
+            vertex[0] = (WorldVertex) {0, 0, x0, y0, z0};
+            vertex[1] = (WorldVertex) {u, 0, x1, y0, z0};
+            vertex[2] = (WorldVertex) {u, v, x1, y0, z1};
+            vertex[3] = (WorldVertex) {0, v, x0, y0, z1};
+            break;
+        case DIR_SOUTH:
+            v = 1;
+            vertex[0] = (WorldVertex) {0, 0, x0, y1, z0};
+            vertex[1] = (WorldVertex) {u, 0, x1, y1, z0};
+            vertex[2] = (WorldVertex) {u, v, x1, y1, z1};
+            vertex[3] = (WorldVertex) {0, v, x0, y1, z1};
+            break;
+    }
+    for (int i = 0; i < 4; i++) {
+        vertex[i].region[0] = region->u0;
+        vertex[i].region[1] = region->v0;
+        vertex[i].region[2] = region->u1 - region->u0;
+        vertex[i].region[3] = region->v1 - region->v0;
+    }
+    return true;
+}
+
+static void free_chunk_mesh(ChunkMesh* mesh) {
+    if (mesh->buffer != 0) {
+        gl_delete_buffers(1, &mesh->buffer);
+        mesh->buffer = 0;
+    }
+    free(mesh->ranges);
+    mesh->ranges = NULL;
+    mesh->range_count = 0;
+}
+
+static int compare_faces(const void* a, const void* b) {
+    GLuint texture_a = ((const WorldFace*)a)->texture;
+    GLuint texture_b = ((const WorldFace*)b)->texture;
+    return (texture_a > texture_b) - (texture_a < texture_b);
+}
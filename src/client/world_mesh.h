@@ -0,0 +1,20 @@
+#ifndef WORLD_MESH_H
+#define WORLD_MESH_H
+
+#include <stdbool.h>
+#include "../shared/game.h"
+#include "render.h"
+
+// The static world geometry, baked into one vertex buffer per chunk. Runs of coplanar faces showing the same
+// atlas region are merged into single quads and the faces are grouped by texture.
+// Meshes are only rebuilt when a chunk they depend on has changed, drawing them is a few calls per chunk.
+bool init_world_mesh(World* world);
+// Call when a chunk has been set, its neighbors are rebuilt too since their walls depend on its cells
+void invalidate_world_mesh_chunk(int chunk_x, int chunk_y);
+void update_world_mesh(World* world);
+// Draws the chunks inside the frustum that may be visible from the eye's region, only those within the
+// frustum's radius of the eye are even tested
+void render_world_mesh(const Frustum* frustum, const Visibility* visibility);
+void free_world_mesh();
+
+#endif // WORLD_MESH_H
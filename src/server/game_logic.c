@@ -1,143 +1,238 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <math.h>
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
 #include "game_logic.h"
 #include "world.h"
 #include "../shared/game.h"
 #include "../shared/vector.h"
 #include "../shared/utils.h"
 #include "../shared/settings.h"
+#include "../shared/movement.h"
+#include "../shared/voxel.h"
+#include "../shared/occupancy.h"
+#include "../shared/job_system.h"
+#include "spatial_hash.h"
+
+#define PLAYER_BATCH_SIZE 4
+#define PROJECTILE_BATCH_SIZE 64
+
+// Input waiting for the next apply_queued_inputs, linked to the player's next queued input
+typedef struct {
+    InputState input;
+    int player_id;
+    int next;
+    bool fired;
+    vec3 shot_origin;
+    vec3 shot_direction;
+} QueuedInput;
+
+typedef struct {
+    GameState* game_state;
+    World* world;
+} TickJobData;
+
+static SpatialHash player_hash;
+static int* nearby_players; // max_players entries per job system worker
+static int* hit_targets;    // Player hit by each projectile position this tick, or -1
+
+static QueuedInput* queued_inputs;
+static int queued_input_count;
+static int queued_input_capacity;
+static int* first_queued_input; // Per player id, -1 when nothing is queued
+static int* last_queued_input;
+static int* queued_players;     // Players with queued inputs, in the order they first sent one
+static int queued_player_count;
+static float* movement_time;    // Per player id, seconds of movement left to spend on queued inputs
 
-#define MAX_CELLS 16
-
-const float MOUSE_SENSITIVITY = 0.001f;
-
-static vec2 process_input(Player* player, InputState* input_state, float delta_time);
-static void process_mouse(Player* player, InputState* input_state);
 static void update_death_timers(GameState* game_state, World* world, float delta_time);
 
+static void move_players_job(void* data, int begin, int end, int worker_index);
 static void calculate_projectile_direction(Player* player, vec3* direction);
-static void create_projectile(Projectile* projectiles, Player* player);
-static void update_projectile(World* world, Projectile* projectile, float deltaTime);
-static void process_projectile_collisions(GameState* game_state, Player* player, float delta_time);
-
-static void update_player_position(Player* player, World* world, float dx, float dy, float deltaTime);
-static bool get_next_z_obstacle(World* world, int cell_x, int cell_y, float z_pos, float* out_obstacle_z);
-static CellInfo* get_cells_for_vector(World* world, vec3 source, vec3 destination, int* num_cells);
-static vec3 get_furthest_legal_position(World* world, vec3 source, vec3 destination, float collision_buffer);
-
-void update(GameState* game_state, World* world, InputState* input_state, int player_index, float delta_time) {
-    Player* player = &game_state->players[player_index];
-    vec2 movement = process_input(player, input_state, delta_time);
-    process_mouse(player, input_state);
-
-    update_player_position(player, world, movement.x, movement.y, delta_time);
-
-    // Update projectiles
-    for (int i = 0; i < MAX_PROJECTILES; i++) {
-        update_projectile(world, &game_state->projectiles[i], delta_time);
+static void create_projectile(GameState* game_state, int owner, vec3 origin, vec3 direction);
+static void update_projectiles(GameState* game_state, World* world, float delta_time);
+static void collide_projectiles_job(void* data, int begin, int end, int worker_index);
+static void integrate_axis(float* position, float* previous, const float* velocity, int count, float delta_time);
+static bool stop_at_solid_cell(World* world, ivec3 grid_position, void* user_data);
+static void process_projectile_hits(GameState* game_state);
+static void find_hits_job(void* data, int begin, int end, int worker_index);
+static int find_hit_player(GameState* game_state, int p, int* nearby);
+static void damage_player(Player* player, int attacker);
+
+bool init_game_logic(GameState* game_state) {
+    int max_players = game_state->max_players;
+    nearby_players = malloc(sizeof(int) * max_players * job_system_worker_count());
+    hit_targets = malloc(sizeof(int) * game_state->max_projectiles);
+    first_queued_input = malloc(sizeof(int) * max_players);
+    last_queued_input = malloc(sizeof(int) * max_players);
+    queued_players = malloc(sizeof(int) * max_players);
+    queued_input_capacity = max_players * 4;
+    queued_inputs = malloc(sizeof(QueuedInput) * queued_input_capacity);
+    movement_time = calloc(max_players, sizeof(float));
+    if (!nearby_players || !hit_targets || !first_queued_input || !last_queued_input || !queued_players || !queued_inputs || !movement_time) {
+        printf("Failed to allocate game logic buffers.\n");
+        return false;
     }
-
-    if (input_state->mouse_button_1.is_down && !input_state->mouse_button_1.was_down) {
-        create_projectile(game_state->projectiles, player);
+    for (int i = 0; i < max_players; i++) {
+        first_queued_input[i] = -1;
     }
+    queued_input_count = 0;
+    queued_player_count = 0;
+    return spatial_hash_init(&player_hash, max_players);
+}
 
-    // Process projectile collisions and update death timers
-    process_projectile_collisions(game_state, player, delta_time);
-    update_death_timers(game_state, world, delta_time);
+void free_game_logic() {
+    spatial_hash_free(&player_hash);
+    free(nearby_players);
+    free(hit_targets);
+    free(first_queued_input);
+    free(last_queued_input);
+    free(queued_players);
+    free(queued_inputs);
+    free(movement_time);
+    nearby_players = NULL;
+    hit_targets = NULL;
+    first_queued_input = NULL;
+    last_queued_input = NULL;
+    queued_players = NULL;
+    queued_inputs = NULL;
+    movement_time = NULL;
 }
 
-static void update_death_timers(GameState* game_state, World* world, float delta_time) {
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        Player* player = &game_state->players[i];
-        if (!player->connected) {
-            continue;
-        }
-        if (player->death_timer > 0.0f) {
-            player->death_timer -= delta_time;
-            if (player->death_timer <= 0) {
-                printf("Player %d was resurrected \n", player->id);
-                player->death_timer = 0;
-                player->health = PLAYER_HEALTH;
-                player->position = get_random_world_pos(world);
-            }
-        }
+void grant_movement_time(GameState* game_state, float tick_time) {
+    float max_movement_time = get_max_movement_time(tick_time);
+    for (int i = 0; i < game_state->player_pool.count; i++) {
+        int player_id = game_state->player_pool.dense[i];
+        movement_time[player_id] = fminf(movement_time[player_id] + tick_time, max_movement_time);
     }
 }
 
-static vec2 process_input(Player* player, InputState* input_state, float delta_time) {
-    vec2 movement = {0.0f, 0.0f};
-    player->jumped = false;
+void reset_movement_time(int player_id) {
+    movement_time[player_id] = 0.0f;
+}
 
-    if (input_state->f.is_down && !input_state->f.was_down) {
-        // Toggle free mode
-        player->free_mode = !player->free_mode;
+bool queue_input(InputState* input_state, int player_id) {
+    if (queued_input_count == queued_input_capacity) {
+        QueuedInput* grown = realloc(queued_inputs, sizeof(QueuedInput) * queued_input_capacity * 2);
+        if (!grown) {
+            return false;
+        }
+        queued_inputs = grown;
+        queued_input_capacity *= 2;
     }
 
-    if (input_state->up.is_down) {
-        movement.x += cosf(player->yaw);
-        movement.y += sinf(player->yaw);
-    }
-    if (input_state->down.is_down) {
-        movement.x -= cosf(player->yaw);
-        movement.y -= sinf(player->yaw);
-    }
-    if (input_state->right.is_down) {
-        movement.x -= sinf(player->yaw);
-        movement.y += cosf(player->yaw);
+    int index = queued_input_count++;
+    QueuedInput* queued = &queued_inputs[index];
+    queued->input = *input_state;
+    queued->player_id = player_id;
+    queued->next = -1;
+    queued->fired = false;
+    if (first_queued_input[player_id] < 0) {
+        first_queued_input[player_id] = index;
+        queued_players[queued_player_count++] = player_id;
+    } else {
+        queued_inputs[last_queued_input[player_id]].next = index;
     }
-    if (input_state->left.is_down) {
-        movement.x += sinf(player->yaw);
-        movement.y -= cosf(player->yaw);
+    last_queued_input[player_id] = index;
+    return true;
+}
+
+void apply_queued_inputs(GameState* game_state, World* world) {
+    if (queued_input_count == 0) {
+        return;
     }
 
-    // Handle jumping and free mode
-    if (input_state->space.is_down) {
-        if (player->free_mode) {
-            player->position.z -= player->speed * delta_time;
-        } else if (player->velocity_z == 0.0f) { // Jump only when the player is on the ground
-            player->velocity_z = player->jump_velocity;
-            player->jumped = true;
+    // Movement only reads the world and writes the moving player, so players move in parallel
+    TickJobData job_data = { game_state, world };
+    job_system_parallel_for(move_players_job, &job_data, queued_player_count, PLAYER_BATCH_SIZE);
+
+    // Shots are created afterwards in the order the inputs arrived, so projectile ids don't depend on threading
+    for (int i = 0; i < queued_input_count; i++) {
+        QueuedInput* queued = &queued_inputs[i];
+        if (queued->fired) {
+            create_projectile(game_state, queued->player_id, queued->shot_origin, queued->shot_direction);
         }
     }
 
-    if (player->free_mode && input_state->shift.is_down) {
-        player->position.z += player->speed * delta_time;
+    for (int i = 0; i < queued_player_count; i++) {
+        first_queued_input[queued_players[i]] = -1;
     }
+    queued_input_count = 0;
+    queued_player_count = 0;
+}
 
-    return movement;
+static void move_players_job(void* data, int begin, int end, int worker_index) {
+    TickJobData* job_data = (TickJobData*)data;
+    for (int i = begin; i < end; i++) {
+        Player* player = &job_data->game_state->players[queued_players[i]];
+        for (int q = first_queued_input[player->id]; q >= 0; q = queued_inputs[q].next) {
+            QueuedInput* queued = &queued_inputs[q];
+            // The client's frame time is only spent out of the player's movement time, so sending more or
+            // longer inputs can't move a player further than the server's own ticks allow
+            float delta_time = fminf(fmaxf(queued->input.delta_time, 0.0f), movement_time[player->id]);
+            movement_time[player->id] -= delta_time;
+            queued->input.delta_time = delta_time;
+            apply_player_movement(player, job_data->world, &queued->input);
+            if (queued->input.mouse_button_1.is_down && !queued->input.mouse_button_1.was_down) {
+                queued->fired = true;
+                queued->shot_origin = player->position;
+                calculate_projectile_direction(player, &queued->shot_direction);
+            }
+            player->last_input_sequence = queued->input.sequence;
+        }
+    }
 }
 
-static void process_mouse(Player* player, InputState* input_state) {
-    // Update player's yaw and pitch based on mouse input
-    player->yaw += input_state->mouse_state.dx * MOUSE_SENSITIVITY;
-    player->pitch -= input_state->mouse_state.dy * MOUSE_SENSITIVITY;
+void update(GameState* game_state, World* world, float delta_time) {
+    update_projectiles(game_state, world, delta_time);
 
-    if (player->pitch < -M_PI / 2) {
-        player->pitch = -M_PI / 2;
-    }
-    if (player->pitch > M_PI / 2) {
-        player->pitch = M_PI / 2;
-    }
+    // Players have moved for this tick, bucket them once and test each projectile against its neighbourhood
+    spatial_hash_rebuild(&player_hash, game_state);
+    process_projectile_hits(game_state);
+    update_death_timers(game_state, world, delta_time);
 }
 
-static void create_projectile(Projectile* projectiles, Player* player) {
-    // Create a new projectile
-    for (int i = 0; i < MAX_PROJECTILES; i++) {
-        if (projectiles[i].ttl < 1) {
-            Projectile* proj = &projectiles[i];
-            proj->position = player->position;
-            proj->speed = 20.0f;
-            proj->size = 1.0f;
-            proj->owner = player->id,
-            proj->ttl = 1000;
-            proj->active = true;
-            calculate_projectile_direction(player, &proj->direction);
-            break;
+static void update_death_timers(GameState* game_state, World* world, float delta_time) {
+    for (int i = 0; i < game_state->player_pool.count; i++) {
+        Player* player = &game_state->players[game_state->player_pool.dense[i]];
+        if (player->death_timer > 0.0f) {
+            player->death_timer -= delta_time;
+            if (player->death_timer <= 0) {
+                printf("Player %d was resurrected \n", player->id);
+                player->death_timer = 0;
+                player->health = PLAYER_HEALTH;
+                player->position = get_random_world_pos(world);
+            }
         }
     }
 }
 
+static void create_projectile(GameState* game_state, int owner, vec3 origin, vec3 direction) {
+    int p = game_state_add_projectile(game_state, -1);
+    if (p < 0) {
+        return;
+    }
+
+    Projectiles* projectiles = &game_state->projectiles;
+    projectiles->x[p] = projectiles->previous_x[p] = origin.x;
+    projectiles->y[p] = projectiles->previous_y[p] = origin.y;
+    projectiles->z[p] = projectiles->previous_z[p] = origin.z;
+    projectiles->direction_x[p] = direction.x;
+    projectiles->direction_y[p] = direction.y;
+    projectiles->direction_z[p] = direction.z;
+    projectiles->speed[p] = 20.0f;
+    projectiles->velocity_x[p] = direction.x * projectiles->speed[p];
+    projectiles->velocity_y[p] = direction.y * projectiles->speed[p];
+    projectiles->velocity_z[p] = direction.z * projectiles->speed[p];
+    projectiles->size[p] = 1.0f;
+    projectiles->owner[p] = owner;
+    projectiles->ttl[p] = 1000;
+    projectiles->active[p] = true;
+}
+
 static void calculate_projectile_direction(Player* player, vec3* direction) {
     float forward_x = cosf(player->yaw) * cosf(player->pitch);
     float forward_y = sinf(player->yaw) * cosf(player->pitch);
@@ -148,277 +243,149 @@ static void calculate_projectile_direction(Player* player, vec3* direction) {
     direction->z = forward_z;
 }
 
-static void update_projectile(World* world, Projectile* projectile, float deltaTime) {
-    if (projectile->ttl < 1) {
-        return;
-    }
-    projectile->ttl--;
-    if (!projectile->active) {
-        return;
-    }
+static void update_projectiles(GameState* game_state, World* world, float delta_time) {
+    Projectiles* projectiles = &game_state->projectiles;
+    int count = game_state->projectile_pool.count;
 
-    vec3 old_pos = {
-        .x = projectile->position.x, 
-        .y = projectile->position.y, 
-        .z = projectile->position.z
-    };
-    vec3 new_pos = {
-        .x = projectile->position.x + projectile->direction.x * projectile->speed * deltaTime,
-        .y = projectile->position.y + projectile->direction.y * projectile->speed * deltaTime,
-        .z = projectile->position.z + projectile->direction.z * projectile->speed * deltaTime
-    };
-
-    int num_cells;
-    CellInfo* cell_infos = get_cells_for_vector(world, old_pos, new_pos, &num_cells);
-    for (int i = 0; i < num_cells; i++) {
-        CellInfo cell_info = cell_infos[i];
-        Cell* cell = cell_info.cell;
-        vec3 cell_position = cell_info.position;
-
-        if (cell != NULL && cell->type == CELL_SOLID) {
-            projectile->active = false;
-            projectile->ttl = 100;
-        }
-    }
-    projectile->position = new_pos;
-}
+    // Stopped projectiles have zero velocity, so every live one can be integrated in one straight pass
+    integrate_axis(projectiles->x, projectiles->previous_x, projectiles->velocity_x, count, delta_time);
+    integrate_axis(projectiles->y, projectiles->previous_y, projectiles->velocity_y, count, delta_time);
+    integrate_axis(projectiles->z, projectiles->previous_z, projectiles->velocity_z, count, delta_time);
 
-void process_projectile_collisions(GameState* game_state, Player* player, float delta_time) {
-    if (!player->connected || player->death_timer > 0) {
-        return;
-    }
+    TickJobData job_data = { game_state, world };
+    job_system_parallel_for(collide_projectiles_job, &job_data, count, PROJECTILE_BATCH_SIZE);
 
-    for (int i = 0; i < MAX_PROJECTILES; i++) {
-        Projectile* projectile  = &game_state->projectiles[i];
-        if (projectile->ttl <= 0 || !projectile->active || projectile->owner == player->id) {
-            continue;
+    // Backwards since removing moves the last projectile into the hole
+    for (int p = count - 1; p >= 0; p--) {
+        if (projectiles->ttl[p] < 1) {
+            game_state_remove_projectile(game_state, p);
         }
+    }
+}
 
-        // Calculate the distance between the player and the projectile
-        float distance = vec3_distance(player->position, projectile->position);
-        float collision_distance = player->size + projectile->size;
-
-        // Check for collision
-        if (distance <= collision_distance) {
-            // Update player health
-            player->health -= 1;
-
-            // Check if the player is dead
-            if (player->health <= 0) {
-                player->death_timer = 8;
-                printf("Player %d killed Player %d \n", projectile->owner, player->id);
+static void collide_projectiles_job(void* data, int begin, int end, int worker_index) {
+    TickJobData* job_data = (TickJobData*)data;
+    Projectiles* projectiles = &job_data->game_state->projectiles;
+    for (int p = begin; p < end; p++) {
+        projectiles->ttl[p]--;
+
+        // Only a projectile that left its cell can have run into a wall, the cell it was in has been checked already
+        vec3 old_pos = { projectiles->previous_x[p], projectiles->previous_y[p], projectiles->previous_z[p] };
+        vec3 new_pos = { projectiles->x[p], projectiles->y[p], projectiles->z[p] };
+        ivec3 old_cell = get_grid_pos3(old_pos.x, old_pos.y, old_pos.z);
+        ivec3 new_cell = get_grid_pos3(new_pos.x, new_pos.y, new_pos.z);
+        bool crossed_cell = old_cell.x != new_cell.x || old_cell.y != new_cell.y || old_cell.z != new_cell.z;
+        if (projectiles->active[p] && crossed_cell) {
+            bool hit_solid = false;
+            traverse_voxels(job_data->world, old_pos, new_pos, stop_at_solid_cell, &hit_solid);
+            if (hit_solid) {
+                projectiles->active[p] = false;
+                projectiles->ttl[p] = 100;
+                projectiles->velocity_x[p] = projectiles->velocity_y[p] = projectiles->velocity_z[p] = 0.0f;
             }
-
-            // Destroy the projectile
-            projectile->active = false;
-            projectile->ttl = 0;
-
-            break; // No need to check for other collisions with this projectile
         }
     }
 }
 
-static void update_player_position(Player* player, World* world, float dx, float dy, float deltaTime) {
-    // Handle free mode unrestricted movement
-    if (player->free_mode) {
-        player->position.x += dx * player->speed * deltaTime;
-        player->position.y += dy * player->speed * deltaTime;
-        player->velocity_z = 0;
-        debuglog(4, "x %f, y %f, z %f \n", player->position.x, player->position.y, player->position.z);
-        return;
+static bool stop_at_solid_cell(World* world, ivec3 grid_position, void* user_data) {
+    if (is_solid_cell(world, grid_position)) {
+        *(bool*)user_data = true;
+        return false;
     }
+    return true;
+}
 
-    // Apply gravity
-    float gravity = get_setting_float("gravity");
-    player->velocity_z += gravity * deltaTime;
-
-    // New player position (to be evaluated)
-    float target_x = player->position.x + dx * player->speed * deltaTime;
-    float target_y = player->position.y + dy * player->speed * deltaTime;
-    float target_z = player->position.z + (player->velocity_z * deltaTime);
-    ivec3 target_grid_pos = get_grid_pos3(target_x, target_y, target_z);
-
-    int z_layer = (int)floor(player->position.z / CELL_Z_SCALE);
-    Layer* layer = &world->layers[z_layer];
-
-    // Calculate the destination position
-    vec3 source = {player->position.x, player->position.y, player->position.z};
-    vec3 destination = {target_x, target_y, target_z};
-
-    // Update the player's position based on the furthest legal position
-    if (z_layer >= 0) {
-        vec3 furthest_legal_position = get_furthest_legal_position(world, source, destination, player->size);
-        target_x = furthest_legal_position.x;
-        target_y = furthest_legal_position.y;
+// position += velocity * delta_time over count entries, keeping the old position
+static void integrate_axis(float* position, float* previous, const float* velocity, int count, float delta_time) {
+    int i = 0;
+#if defined(__AVX__)
+    __m256 step8 = _mm256_set1_ps(delta_time);
+    for (; i + 8 <= count; i += 8) {
+        __m256 current = _mm256_loadu_ps(&position[i]);
+        _mm256_storeu_ps(&previous[i], current);
+        _mm256_storeu_ps(&position[i], _mm256_add_ps(current, _mm256_mul_ps(_mm256_loadu_ps(&velocity[i]), step8)));
     }
-
-    // z-axis handling
-    float next_z_obstacle;
-    bool has_obstacle_down = get_next_z_obstacle(world, target_grid_pos.x, target_grid_pos.y, target_z, &next_z_obstacle);
-    if (has_obstacle_down) {
-        float highest_valid_z = next_z_obstacle - player->height;
-        if (target_z > highest_valid_z) {
-            // Player z movement is obstructed
-            if (player->velocity_z >= 0) {
-                target_z = highest_valid_z;
-                player->velocity_z = 0.0f;
-            } else {
-                target_z = next_z_obstacle + 0.01f;
-                player->velocity_z = 0.01f;
-            }
-        }
+#endif
+#if defined(__SSE__)
+    __m128 step4 = _mm_set1_ps(delta_time);
+    for (; i + 4 <= count; i += 4) {
+        __m128 current = _mm_loadu_ps(&position[i]);
+        _mm_storeu_ps(&previous[i], current);
+        _mm_storeu_ps(&position[i], _mm_add_ps(current, _mm_mul_ps(_mm_loadu_ps(&velocity[i]), step4)));
     }
-
-    // Update player position if the target cell is not solid
-    ivec3 newpos = get_grid_pos3(target_x, target_y, target_z);
-    Cell* cell_candidate;
-    bool got_cell = get_world_cell(world, newpos, &cell_candidate);
-    if (!got_cell || cell_candidate->type != CELL_SOLID) {
-        if (!(player->position.x == target_x && player->position.y == target_y && player->position.z == target_z)) {
-            debuglog(1, "Player: %d,%d (%f, %f, %d) -> %d,%d (%f, %f, %d) \n", (int)(player->position.x / CELL_XY_SCALE), (int)(player->position.y / CELL_XY_SCALE), player->position.x, player->position.y, z_layer, target_grid_pos.x, target_grid_pos.y, target_x, target_y, (int)floor(target_z / CELL_Z_SCALE));
-        }
-        player->position.x = target_x;
-        player->position.y = target_y;
-        player->position.z = target_z;
-    } else {
-        debuglog(1, "Player: rejected: %d,%d (%f, %f, %d) -> %d,%d (%f, %f, %d) \n", (int)(player->position.x / CELL_XY_SCALE), (int)(player->position.y / CELL_XY_SCALE), player->position.x, player->position.y, z_layer, target_grid_pos.x, target_grid_pos.y, target_x, target_y, (int)floor(target_z / CELL_Z_SCALE));
-        ivec3 old_grid_pos = get_grid_pos3(player->position.x, player->position.y, player->position.z);
-        Cell* cell_candidate;
-        bool got_cell = get_world_cell(world, old_grid_pos, &cell_candidate);
-        if (got_cell && cell_candidate->type == CELL_SOLID) {
-            player->position.z -= CELL_Z_SCALE;
-        }
+#endif
+    for (; i < count; i++) {
+        previous[i] = position[i];
+        position[i] += velocity[i] * delta_time;
     }
 }
 
-static vec3 get_furthest_legal_position(World* world, vec3 source, vec3 destination, float collision_buffer) {
-    int num_cells;
-    CellInfo* cell_infos = get_cells_for_vector(world, source, destination, &num_cells);
-    vec3 movement_vector = vec3_subtract(destination, source);
-    float movement_length = vec3_length(movement_vector);
-    vec3 movement_unit_vector = vec3_normalize(movement_vector);
-
-    for (float distance = movement_length; distance >= 0.0f; distance -= collision_buffer) {
-        vec3 candidate_position = vec3_add(source, vec3_multiply_scalar(movement_unit_vector, distance));
-        bool is_valid = true;
-
-        for (int i = 0; i < num_cells; i++) {
-            CellInfo cell_info = cell_infos[i];
-            Cell* cell = cell_info.cell;
-            vec3 cell_position = cell_info.position;
-
-            if (cell != NULL && cell->type == CELL_SOLID) {
-                float distance_to_cell = point_to_aabb_distance_3d(candidate_position.x, candidate_position.y, candidate_position.z,
-                                                                cell_position.x, cell_position.y, cell_position.z,
-                                                                cell_position.x + CELL_XY_SCALE, cell_position.y + CELL_XY_SCALE, cell_position.z + CELL_Z_SCALE);
-                if (distance_to_cell <= collision_buffer) {
-                    is_valid = false;
-                    break;
-                }
-            }
+static void process_projectile_hits(GameState* game_state) {
+    Projectiles* projectiles = &game_state->projectiles;
+    int count = game_state->projectile_pool.count;
+
+    // Finding hits only reads, so every projectile is tested in parallel against where players are now
+    TickJobData job_data = { game_state, NULL };
+    job_system_parallel_for(find_hits_job, &job_data, count, PROJECTILE_BATCH_SIZE);
+
+    // Damage is applied serially in position order. A target killed earlier in this loop can't take the
+    // hit, so that projectile looks again with the updated state, same as if everything ran serially.
+    // Backwards since projectiles that hit are removed as we go.
+    for (int p = count - 1; p >= 0; p--) {
+        int target = hit_targets[p];
+        if (target >= 0 && game_state->players[target].death_timer > 0) {
+            target = find_hit_player(game_state, p, nearby_players);
         }
-
-        if (is_valid) {
-            return candidate_position;
+        if (target >= 0) {
+            damage_player(&game_state->players[target], projectiles->owner[p]);
+            game_state_remove_projectile(game_state, p);
         }
     }
-
-    return source;
 }
 
-static CellInfo* get_cells_for_vector(World* world, vec3 source, vec3 destination, int* num_cells) {
-    assert(num_cells != NULL);
-
-    // Allocate memory for the cell information array
-    static CellInfo cell_infos[MAX_CELLS];
-    *num_cells = 0;
-
-    // Convert source and destination to cell coordinates
-    int x0 = (int)(source.x / CELL_XY_SCALE);
-    int y0 = (int)(source.y / CELL_XY_SCALE);
-    int z0 = (int)(source.z / CELL_Z_SCALE);
-    int x1 = (int)(destination.x / CELL_XY_SCALE);
-    int y1 = (int)(destination.y / CELL_XY_SCALE);
-    int z1 = (int)(destination.z / CELL_Z_SCALE);
-
-    // Bresenham's line algorithm in 3D
-    int dx = abs(x1 - x0);
-    int dy = abs(y1 - y0);
-    int dz = abs(z1 - z0);
-    int sx = (x0 < x1) ? 1 : -1;
-    int sy = (y0 < y1) ? 1 : -1;
-    int sz = (z0 < z1) ? 1 : -1;
-
-    int dm = MAX(dx, MAX(dy, dz));
-    int i;
-    for (i = dm * 2; i > 0; i--) {
-        // Check if the cell is within the world bounds
-        if (x0 >= 0 && x0 < world->layers[0].width &&
-            y0 >= 0 && y0 < world->layers[0].height &&
-            z0 >= 0 && z0 < world->num_layers) {
-            Cell* cell;
-            if (get_world_cell(world, (ivec3){x0, y0, z0}, &cell)) {
-                // Add cell information to the array
-                cell_infos[*num_cells].cell = cell;
-                cell_infos[*num_cells].position = (vec3){x0 * CELL_XY_SCALE, y0 * CELL_XY_SCALE, z0 * CELL_Z_SCALE};
-                (*num_cells)++;
-            }
-        }
-
-        if (x0 == x1 && y0 == y1 && z0 == z1) {
-            break;
-        }
-
-        int x_err = 2 * abs(dm - dx);
-        int y_err = 2 * abs(dm - dy);
-        int z_err = 2 * abs(dm - dz);
-
-        if (x_err <= dm) {
-            dm -= dx;
-            x0 += sx;
-        }
-        if (y_err <= dm) {
-            dm -= dy;
-            y0 += sy;
-        }
-        if (z_err <= dm) {
-            dm -= dz;
-            z0 += sz;
-        }
+static void find_hits_job(void* data, int begin, int end, int worker_index) {
+    GameState* game_state = ((TickJobData*)data)->game_state;
+    int* nearby = &nearby_players[worker_index * game_state->max_players];
+    for (int p = begin; p < end; p++) {
+        hit_targets[p] = find_hit_player(game_state, p, nearby);
     }
-
-    return cell_infos;
 }
 
-static bool get_next_z_obstacle(World* world, int cell_x, int cell_y, float z_pos, float* out_obstacle_z) {
-    int z_layer = (int)(z_pos / CELL_Z_SCALE);
-    if (z_layer >= world->num_layers) {
-        return false;
+// Id of the first player along the projectile's path this tick, or -1
+static int find_hit_player(GameState* game_state, int p, int* nearby) {
+    Projectiles* projectiles = &game_state->projectiles;
+    if (!projectiles->active[p]) {
+        return -1;
     }
 
-    int first_check_layer = z_layer >= 0 ? z_layer : 0; 
-
-    for (int i = first_check_layer; i < world->num_layers; i++) {
-        Layer* layer = &world->layers[i];
-        if (!is_within_xy_bounds(layer, cell_x, cell_y)) {
+    // Sweep the projectile over the path it took this tick so fast ones can't skip past a player
+    vec3 start = { projectiles->previous_x[p], projectiles->previous_y[p], projectiles->previous_z[p] };
+    vec3 end = { projectiles->x[p], projectiles->y[p], projectiles->z[p] };
+    float size = projectiles->size[p];
+    vec3 min = { fminf(start.x, end.x) - size, fminf(start.y, end.y) - size, fminf(start.z, end.z) - size };
+    vec3 max = { fmaxf(start.x, end.x) + size, fmaxf(start.y, end.y) + size, fmaxf(start.z, end.z) + size };
+    int nearby_count = spatial_hash_query(&player_hash, min, max, nearby, game_state->max_players);
+
+    int hit_player = -1;
+    float hit_t = 2.0f;
+    for (int i = 0; i < nearby_count; i++) {
+        Player* player = &game_state->players[nearby[i]];
+        if (player->death_timer > 0 || player->id == projectiles->owner[p]) {
             continue;
         }
-        Cell* cell = get_cell(layer, cell_x, cell_y);
-
-        //Check ceiling if they are below player
-        if (z_pos < (float)i * CELL_Z_SCALE) {
-            if (cell->type == CELL_ROOM || cell->type == CELL_SOLID) {
-                *out_obstacle_z = (float)i * CELL_Z_SCALE;
-                return true;
-            }
-        }
-
-        //Check floors
-        if (cell->type != CELL_VOID) {
-            *out_obstacle_z = (float)i * CELL_Z_SCALE + 4;
-            return true;
+        float t;
+        if (segment_sphere_intersection(start, end, player->position, player->size + size, &t) && t < hit_t) {
+            hit_player = player->id;
+            hit_t = t;
         }
     }
+    return hit_player;
+}
 
-    return false; // No obstacle found
+static void damage_player(Player* player, int attacker) {
+    player->health -= 1;
+    if (player->health <= 0) {
+        player->death_timer = 8;
+        printf("Player %d killed Player %d \n", attacker, player->id);
+    }
 }
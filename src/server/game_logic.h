@@ -5,12 +5,16 @@
 #include "../shared/vector.h"
 #include "world.h"
 
-typedef struct {
-    Cell* cell;
-    vec3 position;
-} CellInfo;
-
 bool start_level(GameState* gamestate, const char* level);
-void update(GameState* game_state, World* world, InputState* input_state, int player_index, float delta_time);
+bool init_game_logic(GameState* game_state);
+void free_game_logic();
+// Inputs are queued as they arrive and applied together, with players moved in parallel
+bool queue_input(InputState* input_state, int player_id);
+// Called once per tick before inputs are applied, limits how much time a player's inputs can move it
+void grant_movement_time(GameState* game_state, float tick_time);
+// A joining player starts without banked movement time, whatever the id's previous player left
+void reset_movement_time(int player_id);
+void apply_queued_inputs(GameState* game_state, World* world);
+void update(GameState* game_state, World* world, float delta_time);
 
 #endif // GAME_LOGIC_H
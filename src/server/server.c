@@ -1,7 +1,7 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_net.h>
 #include <SDL2/SDL_thread.h>
-#include <SDL2/SDL_mutex.h>
+#include <SDL2/SDL_atomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,40 +13,137 @@
 #include "../shared/utils.h"
 #include "../shared/settings.h"
 #include "../shared/vector.h"
+#include "../shared/spsc_queue.h"
+#include "../shared/net_buffer.h"
+#include "../shared/snapshot.h"
+#include "../shared/protocol.h"
+#include "../shared/tcp_stream.h"
+#include "../shared/job_system.h"
+#include "../shared/chunk.h"
+#include "../shared/cell_definitions.h"
+#include "../shared/visibility.h"
 
-#define BUFFER_SIZE 8192
+#define NET_EVENTS_PER_PLAYER 4
+#define NET_INPUTS_PER_PLAYER 64
+#define MAX_CATCHUP_TICKS 5
+#define NETWORK_POLL_TIMEOUT_MS 1
+#define TCP_FLUSH_CHUNK_SIZE 4096
 
+typedef enum {
+    SLOT_FREE,
+    SLOT_CONNECTED,
+    SLOT_LEAVING // Closed, waiting for room in the event queue to tell the simulation
+} SlotState;
+
+// One per player id, only touched by the network thread
+typedef struct {
+    SlotState state;
+    TcpStream stream;
+    Uint32 connection_token;
+    bool has_address;
+    IPaddress address;
+    Uint32 last_received_input;
+    Uint32 snapshot_ack;
+    // The world is streamed while joining, in square rings of chunks around the spawn point
+    int world_center_x;
+    int world_center_y;
+    int world_ring;
+    int world_ring_index;
+    int world_chunks_sent;
+    bool world_visibility_sent;
+} ClientSlot;
+
+typedef enum {
+    NET_EVENT_JOIN,
+    NET_EVENT_LEAVE
+} NetEventType;
+
+// Network thread -> simulation, joins and leaves in the order they happened
+typedef struct {
+    NetEventType type;
+    int player_id;
+    Uint32 connection_token;
+    vec3 spawn_position; // Picked when the client connects so its part of the world can be sent first
+} NetEvent;
+
+// Network thread -> simulation, one queue per player id so a flooding client only fills its own
+typedef struct {
+    Uint32 connection_token; // Inputs left over from the slot's previous client are dropped
+    InputState input;
+} NetInput;
+
+// Recent snapshots published by the simulation and read by the network thread (seqlock per slot)
+typedef struct {
+    SDL_atomic_t sequence;
+    Snapshot snapshot;
+    Uint32 input_acks[MAX_PLAYERS];
+} PublishedSnapshot;
+
+// Visibility region of every entity in a snapshot, so filtering it for each client only takes table lookups
 typedef struct {
-    TCPsocket socket;
-    Player* player;
-    GameState* game_state;
-    World* world;
-    SDL_mutex* game_state_mutex;
-    float* delta_time;
-} ClientData;
+    int players[MAX_PLAYERS];
+    int projectiles[MAX_PROJECTILES];
+} EntityRegions;
 
 World world;
-float delta_time;
+static ClientSlot* client_slots;
+static int max_players;
+static int max_projectiles;
+static SpscQueue net_events;
+static SpscQueue* net_inputs;        // Per player id
+static Uint32* connection_tokens;    // Per player id, the token of the client the simulation last saw join
+static PublishedSnapshot published_snapshots[SNAPSHOT_HISTORY_SIZE];
+static SDL_atomic_t latest_published_tick;
+static TCPsocket server_socket;
+static UDPsocket udp_socket;
+static SDLNet_SocketSet socket_set;
+static int tick_rate;
+static Uint8* world_chunk_message; // Encoding space for one chunk, used by the network thread
+static int world_chunk_count;
+static Uint8* world_visibility_message; // Encoded once, NULL when the world has no visibility table
+static int world_visibility_message_length;
 
-Player* add_new_player(GameState* game_state, World* world) {
-    int player_index = -1;
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (!game_state->players[i].connected) {
-            player_index = i;
-            break;
-        }
-    }
-    if (player_index < 0) {
-        return NULL;
+static void publish_snapshot(const GameState* game_state) {
+    PublishedSnapshot* published = &published_snapshots[game_state->tick % SNAPSHOT_HISTORY_SIZE];
+
+    // Odd sequence means a write is in progress
+    SDL_AtomicIncRef(&published->sequence);
+    SDL_MemoryBarrierRelease();
+    snapshot_capture(&published->snapshot, game_state);
+    for (int i = 0; i < game_state->player_pool.count; i++) {
+        int id = game_state->player_pool.dense[i];
+        published->input_acks[id] = game_state->players[id].last_input_sequence;
     }
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicIncRef(&published->sequence);
 
-    int player_x = rand() % (world->layers[0].width + 1);
-    int player_y = rand() % (world->layers[0].height + 1);
+    SDL_AtomicSet(&latest_published_tick, (int)game_state->tick);
+}
+
+static bool read_published_snapshot(Uint32 tick, Snapshot* out_snapshot, Uint32* out_input_acks) {
+    PublishedSnapshot* published = &published_snapshots[tick % SNAPSHOT_HISTORY_SIZE];
+    int sequence_before, sequence_after;
+    do {
+        sequence_before = SDL_AtomicGet(&published->sequence);
+        SDL_MemoryBarrierAcquire();
+        snapshot_copy(out_snapshot, &published->snapshot);
+        if (out_input_acks) {
+            memcpy(out_input_acks, published->input_acks, sizeof(Uint32) * max_players);
+        }
+        SDL_MemoryBarrierAcquire();
+        sequence_after = SDL_AtomicGet(&published->sequence);
+    } while ((sequence_before & 1) || sequence_before != sequence_after);
+
+    // The slot may already hold a newer tick
+    return out_snapshot->tick == tick;
+}
+
+Player* add_new_player(GameState* game_state, vec3 spawn_position, int player_index) {
     float player_height = CELL_Z_SCALE / 2;
     game_state->players[player_index] = (Player) {
         .id = player_index,
-        .position.x = player_x,
-        .position.y = player_y,
+        .position.x = spawn_position.x,
+        .position.y = spawn_position.y,
         .position.z = 4 - player_height,
         .height = player_height,
         .speed = 10.0f,
@@ -59,54 +156,362 @@ Player* add_new_player(GameState* game_state, World* world) {
     return &game_state->players[player_index];
 }
 
-int handle_client(void* data) {
-    ClientData* client_data = (ClientData*)data;
-    GameState* game_state = client_data->game_state;
-    World* world = client_data->world;
-    Player* player = client_data->player;
-    TCPsocket client_socket = client_data->socket;
-    float delta_time = *client_data->delta_time;
+static void handle_input_packet(NetBuffer* buffer, IPaddress address) {
+    InputPacket packet;
+    if (!read_input_packet(buffer, &packet) || packet.player_id < 0 || packet.player_id >= max_players) {
+        return;
+    }
+    ClientSlot* slot = &client_slots[packet.player_id];
+    if (slot->state != SLOT_CONNECTED || packet.connection_token != slot->connection_token) {
+        return; // Stale or forged packet
+    }
 
-    // Send initial game state to the client
-    InitialGameState initial_game_state = {
-        .world = *world,
-        .player_id = player->id
+    slot->address = address;
+    slot->has_address = true;
+    if (packet.snapshot_ack > slot->snapshot_ack) {
+        slot->snapshot_ack = packet.snapshot_ack;
+    }
+
+    // Queue every input we haven't seen yet, oldest first; redundant copies are skipped
+    for (int i = packet.input_count - 1; i >= 0; i--) {
+        InputState* input_state = &packet.inputs[i];
+        if (input_state->sequence <= slot->last_received_input) {
+            continue;
+        }
+        NetInput net_input = { .connection_token = slot->connection_token, .input = *input_state };
+        if (!spsc_queue_push(&net_inputs[packet.player_id], &net_input)) {
+            debuglog(1, "Input queue full, dropping input from player %d\n", packet.player_id);
+            break;
+        }
+        slot->last_received_input = input_state->sequence;
+    }
+}
+
+static void get_entity_regions(const Snapshot* snapshot, EntityRegions* out_regions) {
+    for (int i = 0; i < snapshot->players_count; i++) {
+        out_regions->players[i] = get_visibility_region(&world.visibility, get_snapshot_entity_position(&snapshot->players[i]));
+    }
+    for (int i = 0; i < snapshot->projectiles_count; i++) {
+        out_regions->projectiles[i] = get_visibility_region(&world.visibility, get_snapshot_entity_position(&snapshot->projectiles[i]));
+    }
+}
+
+// Leaves out the entities the player can't see from where it is in the snapshot. That only depends on the
+// snapshot, so a baseline filtered again comes out the same as when it was sent.
+static void filter_visible_entities(Snapshot* destination, const Snapshot* source, const EntityRegions* regions, int player_id) {
+    int from_region = -1;
+    for (int i = 0; i < source->players_count; i++) {
+        if (source->players[i].id == player_id) {
+            from_region = regions->players[i];
+            break;
+        }
+    }
+    destination->tick = source->tick;
+    destination->players_count = 0;
+    for (int i = 0; i < source->players_count; i++) {
+        if (source->players[i].id == player_id || is_region_visible(&world.visibility, from_region, regions->players[i])) {
+            destination->players[destination->players_count++] = source->players[i];
+        }
+    }
+    destination->projectiles_count = 0;
+    for (int i = 0; i < source->projectiles_count; i++) {
+        if (is_region_visible(&world.visibility, from_region, regions->projectiles[i])) {
+            destination->projectiles[destination->projectiles_count++] = source->projectiles[i];
+        }
+    }
+}
+
+static void send_snapshots(UDPpacket* packet, Uint32 tick) {
+    static Snapshot snapshot;
+    static Snapshot baseline;
+    static Snapshot visible_snapshot;
+    static Snapshot visible_baseline;
+    static EntityRegions snapshot_regions;
+    static EntityRegions baseline_regions;
+    static Uint32 input_acks[MAX_PLAYERS];
+    if (!read_published_snapshot(tick, &snapshot, input_acks)) {
+        return; // Already overwritten, a newer tick will follow
+    }
+    bool filter_entities = world.visibility.bits != NULL;
+    if (filter_entities) {
+        get_entity_regions(&snapshot, &snapshot_regions);
+    }
+
+    // Most clients ack the same recent tick, so only read a baseline again when the ack differs
+    Uint32 baseline_tick = 0;
+    for (int i = 0; i < max_players; i++) {
+        ClientSlot* slot = &client_slots[i];
+        if (slot->state != SLOT_CONNECTED || !slot->has_address) {
+            continue;
+        }
+
+        Uint32 ack = slot->snapshot_ack;
+        bool usable_ack = ack != 0 && ack <= tick && tick - ack < SNAPSHOT_HISTORY_SIZE;
+        if (usable_ack && ack != baseline_tick) {
+            baseline_tick = read_published_snapshot(ack, &baseline, NULL) ? ack : 0;
+            if (filter_entities && baseline_tick != 0) {
+                get_entity_regions(&baseline, &baseline_regions);
+            }
+        }
+        bool have_baseline = usable_ack && ack == baseline_tick;
+
+        const Snapshot* client_snapshot = &snapshot;
+        const Snapshot* client_baseline = have_baseline ? &baseline : NULL;
+        if (filter_entities) {
+            filter_visible_entities(&visible_snapshot, &snapshot, &snapshot_regions, i);
+            client_snapshot = &visible_snapshot;
+            if (have_baseline) {
+                filter_visible_entities(&visible_baseline, &baseline, &baseline_regions, i);
+                client_baseline = &visible_baseline;
+            }
+        }
+
+        // Big snapshots go out as several packets, every part is delta compressed against the same baseline
+        SnapshotCursor cursor = { 0 };
+        while (!cursor.done) {
+            NetBuffer buffer;
+            net_buffer_init(&buffer, packet->data, packet->maxlen);
+            write_snapshot_packet_header(&buffer, input_acks[i]);
+            if (!snapshot_encode_part(client_snapshot, client_baseline, &cursor, &buffer)) {
+                printf("Snapshot for player %d does not fit in %d packets.\n", i, SNAPSHOT_MAX_PARTS);
+                break;
+            }
+
+            packet->len = buffer.length;
+            packet->address = slot->address;
+            SDLNet_UDP_Send(udp_socket, -1, packet);
+        }
+    }
+}
+
+static Uint32 generate_connection_token() {
+    Uint32 token = 0;
+    while (token == 0) {
+        token = ((Uint32)rand() << 16) ^ (Uint32)rand() ^ SDL_GetTicks();
+    }
+    return token;
+}
+
+static void accept_new_client() {
+    TCPsocket client_socket = SDLNet_TCP_Accept(server_socket);
+    if (!client_socket) {
+        return;
+    }
+
+    int player_id = -1;
+    for (int i = 0; i < max_players; i++) {
+        if (client_slots[i].state == SLOT_FREE) {
+            player_id = i;
+            break;
+        }
+    }
+    vec3 spawn_position = {
+        .x = rand() % (world.width + 1),
+        .y = rand() % (world.height + 1)
     };
-    int sent_initial = SDLNet_TCP_Send(client_socket, &initial_game_state, sizeof(initial_game_state));
-    if (sent_initial < sizeof(initial_game_state)) {
-        printf("Error sending initial game state to the client.\n");
+    Uint32 connection_token = generate_connection_token();
+    NetEvent event = { .type = NET_EVENT_JOIN, .player_id = player_id, .connection_token = connection_token, .spawn_position = spawn_position };
+    if (player_id < 0 || !spsc_queue_push(&net_events, &event)) {
+        printf("Server is full. Client connection rejected.\n");
         SDLNet_TCP_Close(client_socket);
-        free(client_data);
-        return 1;
+        return;
     }
+    printf("Client connected!\n");
+
+    ClientSlot* slot = &client_slots[player_id];
+    slot->state = SLOT_CONNECTED;
+    slot->connection_token = connection_token;
+    slot->has_address = false;
+    slot->last_received_input = 0;
+    slot->snapshot_ack = 0;
+    slot->world_center_x = ((int)spawn_position.x / CELL_XY_SCALE) >> CHUNK_SHIFT;
+    slot->world_center_y = ((int)spawn_position.y / CELL_XY_SCALE) >> CHUNK_SHIFT;
+    slot->world_ring = 0;
+    slot->world_ring_index = 0;
+    slot->world_chunks_sent = 0;
+    slot->world_visibility_sent = false;
+    tcp_stream_init(&slot->stream, client_socket);
+    SDLNet_TCP_AddSocket(socket_set, client_socket);
+
+    // The world follows over TCP a chunk at a time, see queue_next_world_chunk
+    InitialGameState initial_game_state = {
+        .world_width = world.width,
+        .world_height = world.height,
+        .world_layers = world.num_layers,
+        .world_chunk_count = world_chunk_count,
+        .cell_definitions_checksum = get_cell_definitions_checksum(),
+        .gravity = world.gravity,
+        .player_id = player_id,
+        .max_players = max_players,
+        .max_projectiles = max_projectiles,
+        .connection_token = slot->connection_token,
+        .tick_rate = tick_rate
+    };
+    tcp_stream_queue_frame(&slot->stream, MESSAGE_INITIAL_GAME_STATE, &initial_game_state, sizeof(initial_game_state));
+}
+
+static void close_client(ClientSlot* slot) {
+    SDLNet_TCP_DelSocket(socket_set, slot->stream.socket);
+    SDLNet_TCP_Close(slot->stream.socket);
+    tcp_stream_free(&slot->stream);
+    slot->state = SLOT_LEAVING;
+    slot->connection_token = 0;
+    printf("Client disconnected.\n");
+}
+
+// Queues the joining client's next chunk of the world, if any are left, and then the visibility table.
+// Chunks nearest the spawn point go first so the client can start playing while the rest of the level arrives.
+static void queue_next_world_chunk(ClientSlot* slot) {
+    int max_ring = world.chunks_x > world.chunks_y ? world.chunks_x : world.chunks_y;
+    while (slot->world_chunks_sent < world_chunk_count && slot->world_ring <= max_ring) {
+        // Ring r is the 8r chunks at distance r, walked one side of 2r chunks at a time
+        int ring = slot->world_ring;
+        int offset = ring > 0 ? slot->world_ring_index % (ring * 2) : 0;
+        int dx = 0;
+        int dy = 0;
+        switch (ring > 0 ? slot->world_ring_index / (ring * 2) : 0) {
+            case 0: dx = offset - ring; dy = -ring; break;
+            case 1: dx = ring; dy = offset - ring; break;
+            case 2: dx = ring - offset; dy = ring; break;
+            default: dx = -ring; dy = ring - offset; break;
+        }
+        if (++slot->world_ring_index >= (ring > 0 ? ring * 8 : 1)) {
+            slot->world_ring++;
+            slot->world_ring_index = 0;
+        }
+
+        int chunk_x = slot->world_center_x + dx;
+        int chunk_y = slot->world_center_y + dy;
+        if (!get_chunk(&world, chunk_x, chunk_y)) {
+            continue;
+        }
+        NetBuffer buffer;
+        net_buffer_init(&buffer, world_chunk_message, get_world_chunk_message_size(&world));
+        write_world_chunk(&buffer, &world, chunk_x, chunk_y);
+        tcp_stream_queue_frame(&slot->stream, MESSAGE_WORLD_CHUNK, buffer.data, buffer.length);
+        slot->world_chunks_sent++;
+        return;
+    }
+    if (world_visibility_message && !slot->world_visibility_sent) {
+        tcp_stream_queue_frame(&slot->stream, MESSAGE_WORLD_VISIBILITY, world_visibility_message, world_visibility_message_length);
+        slot->world_visibility_sent = true;
+    }
+}
+
+static void service_client(ClientSlot* slot) {
+    if (SDLNet_SocketReady(slot->stream.socket)) {
+        if (!tcp_stream_receive(&slot->stream)) {
+            close_client(slot);
+            return;
+        }
+        // Gameplay runs over UDP, clients don't send anything over TCP yet
+        Uint8 type;
+        const Uint8* data;
+        int length;
+        while (tcp_stream_next_frame(&slot->stream, &type, &data, &length)) {
+            debuglog(1, "Ignoring TCP message %d from player %d\n", type, (int)(slot - client_slots));
+        }
+    }
+
+    // Only top up once the previous chunk is on its way, so a join never buffers the whole level
+    if (!tcp_stream_has_pending_writes(&slot->stream)) {
+        queue_next_world_chunk(slot);
+    }
+    if (!tcp_stream_flush(&slot->stream, TCP_FLUSH_CHUNK_SIZE)) {
+        close_client(slot);
+    }
+}
+
+// Every socket is serviced from this one thread; the simulation only sees the resulting events
+static int network_thread(void* data) {
+    UDPpacket* packet = SDLNet_AllocPacket(MAX_PACKET_SIZE);
+    Uint32 last_sent_tick = 0;
 
-    // Loop until the client disconnects
     while (1) {
-        InputState input_state;
-        int received = SDLNet_TCP_Recv(client_socket, &input_state, sizeof(input_state));
-        if (received <= 0) {
-            break; // Client disconnected or an error occurred
+        // Don't wait on the sockets while there is still something to write, unless the client isn't reading it
+        bool pending_writes = false;
+        for (int i = 0; i < max_players; i++) {
+            TcpStream* stream = &client_slots[i].stream;
+            if (client_slots[i].state == SLOT_CONNECTED && tcp_stream_has_pending_writes(stream) && !stream->write_blocked) {
+                pending_writes = true;
+            }
         }
+        int ready = SDLNet_CheckSockets(socket_set, pending_writes ? 0 : NETWORK_POLL_TIMEOUT_MS);
 
-        // Process the received input state and update the game state
-        SDL_LockMutex(client_data->game_state_mutex);
-        update(game_state, world, &input_state, player->id, delta_time);
-        SDL_UnlockMutex(client_data->game_state_mutex);
+        if (ready > 0 && SDLNet_SocketReady(server_socket)) {
+            accept_new_client();
+        }
+        for (int i = 0; i < max_players; i++) {
+            ClientSlot* slot = &client_slots[i];
+            if (slot->state == SLOT_CONNECTED) {
+                service_client(slot);
+            }
+            if (slot->state == SLOT_LEAVING) {
+                NetEvent event = { .type = NET_EVENT_LEAVE, .player_id = i };
+                if (spsc_queue_push(&net_events, &event)) {
+                    slot->state = SLOT_FREE;
+                }
+            }
+        }
+        if (ready > 0 && SDLNet_SocketReady(udp_socket)) {
+            while (SDLNet_UDP_Recv(udp_socket, packet) > 0) {
+                NetBuffer buffer;
+                net_buffer_init_read(&buffer, packet->data, packet->len);
+                if (read_packet_type(&buffer) == PACKET_INPUT) {
+                    handle_input_packet(&buffer, packet->address);
+                }
+            }
+        }
 
-        // Send the updated game state back to the client
-        int sent = SDLNet_TCP_Send(client_socket, game_state, sizeof(*game_state));
-        if (sent < sizeof(*game_state)) {
-            break; // An error occurred while sending the data or the client disconnected
+        Uint32 tick = (Uint32)SDL_AtomicGet(&latest_published_tick);
+        if (tick != last_sent_tick) {
+            send_snapshots(packet, tick);
+            last_sent_tick = tick;
         }
     }
 
-    player->connected = false;
-    SDLNet_TCP_Close(client_socket);
-    printf("Client disconnected.\n");
-    free(client_data);
+    SDLNet_FreePacket(packet);
     return 0;
 }
 
+static void run_tick(GameState* game_state, float tick_time) {
+    // Apply the joins and leaves that arrived since the last tick, then every player's inputs.
+    // Inputs are batched so players can move in parallel; a leaving player's last inputs are dropped.
+    NetEvent event;
+    while (spsc_queue_pop(&net_events, &event)) {
+        Player* player = &game_state->players[event.player_id];
+        switch (event.type) {
+            case NET_EVENT_JOIN:
+                entity_pool_alloc_index(&game_state->player_pool, event.player_id);
+                add_new_player(game_state, event.spawn_position, event.player_id);
+                reset_movement_time(event.player_id);
+                connection_tokens[event.player_id] = event.connection_token;
+                break;
+            case NET_EVENT_LEAVE:
+                entity_pool_release(&game_state->player_pool, event.player_id);
+                player->connected = false;
+                break;
+        }
+    }
+
+    grant_movement_time(game_state, tick_time);
+    for (int i = 0; i < max_players; i++) {
+        NetInput net_input;
+        while (spsc_queue_pop(&net_inputs[i], &net_input)) {
+            if (!game_state->players[i].connected || net_input.connection_token != connection_tokens[i]) {
+                continue;
+            }
+            if (!queue_input(&net_input.input, i)) {
+                printf("Dropped input from player %d, out of memory.\n", i);
+            }
+        }
+    }
+    apply_queued_inputs(game_state, &world);
+
+    update(game_state, &world, tick_time);
+    game_state->tick++;
+}
+
 int main(int argc, char *argv[]) {
     initialize_default_server_settings();
     int server_port = get_setting_int("server_port");
@@ -128,12 +533,19 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
-    TCPsocket server_socket = SDLNet_TCP_Open(&server_ip);
+    server_socket = SDLNet_TCP_Open(&server_ip);
     if (!server_socket) {
         printf("Error opening server socket: %s\n", SDLNet_GetError());
         return 1;
     }
 
+    // Gameplay traffic uses a UDP socket on the same port number
+    udp_socket = SDLNet_UDP_Open(server_port);
+    if (!udp_socket) {
+        printf("Error opening server UDP socket: %s\n", SDLNet_GetError());
+        return 1;
+    }
+
     printf("Server listening on port %d...\n", server_port);
 
     // Load level data
@@ -142,66 +554,135 @@ int main(int argc, char *argv[]) {
         printf("Failed to load world.\n");
         return false;
     }
+    world.gravity = get_setting_float("gravity");
+    world_chunk_count = count_world_chunks(&world);
+    world_chunk_message = malloc(get_world_chunk_message_size(&world));
+    if (!world_chunk_message) {
+        printf("Failed to allocate the world chunk buffer.\n");
+        return 1;
+    }
+    if (world.visibility.bits) {
+        int message_size = get_world_visibility_message_size(&world.visibility);
+        world_visibility_message = malloc(message_size);
+        if (!world_visibility_message) {
+            printf("Failed to allocate the world visibility buffer.\n");
+            return 1;
+        }
+        NetBuffer buffer;
+        net_buffer_init(&buffer, world_visibility_message, message_size);
+        write_world_visibility(&buffer, &world.visibility);
+        world_visibility_message_length = buffer.length;
+    } else {
+        printf("The level has no visibility table, every client is sent every entity.\n");
+    }
 
-    // Initialize game state
+    // Initialize game state, sized from the settings within what the snapshot format can carry
+    max_players = get_setting_int("max_players");
+    max_projectiles = get_setting_int("max_projectiles");
+    if (max_players < 1 || max_players > MAX_PLAYERS || max_projectiles < 1 || max_projectiles > MAX_PROJECTILES) {
+        printf("max_players must be 1-%d and max_projectiles 1-%d.\n", MAX_PLAYERS, MAX_PROJECTILES);
+        return 1;
+    }
     GameState game_state;
-    game_state.players_count = 0;
-    memset(game_state.projectiles, 0, sizeof(game_state.projectiles));
-    memset(game_state.players, 0, sizeof(game_state.players));
+    if (!job_system_init(get_setting_int("worker_threads"))) {
+        return 1;
+    }
+    if (!game_state_init(&game_state, max_players, max_projectiles) || !init_game_logic(&game_state)) {
+        return 1;
+    }
+    publish_snapshot(&game_state);
 
     // Prepare for multi-client handling
-    SDL_Thread* client_threads[MAX_CLIENTS];
-
-    // Create a mutex for synchronizing access to the game state
-    SDL_mutex* game_state_mutex = SDL_CreateMutex();
+    client_slots = calloc(max_players, sizeof(ClientSlot));
+    if (!client_slots) {
+        printf("Failed to allocate client slots.\n");
+        return 1;
+    }
+    for (int i = 0; i < max_players; i++) {
+        client_slots[i].state = SLOT_FREE;
+    }
+    if (!spsc_queue_init(&net_events, sizeof(NetEvent), max_players * NET_EVENTS_PER_PLAYER)) {
+        printf("Failed to allocate the network event queue.\n");
+        return 1;
+    }
+    net_inputs = calloc(max_players, sizeof(SpscQueue));
+    connection_tokens = calloc(max_players, sizeof(Uint32));
+    if (!net_inputs || !connection_tokens) {
+        printf("Failed to allocate the network input queues.\n");
+        return 1;
+    }
+    for (int i = 0; i < max_players; i++) {
+        if (!spsc_queue_init(&net_inputs[i], sizeof(NetInput), NET_INPUTS_PER_PLAYER)) {
+            printf("Failed to allocate the network input queues.\n");
+            return 1;
+        }
+    }
+    socket_set = SDLNet_AllocSocketSet(max_players + 2);
+    SDLNet_TCP_AddSocket(socket_set, server_socket);
+    SDLNet_UDP_AddSocket(socket_set, udp_socket);
 
-    const Uint32 targetTickRate = 60;
-    const Uint32 targetTickTime = 1000 / targetTickRate; // 1000ms / target TPS
-    Uint32 lastTickTime = 0;
+    // The simulation runs at a fixed tick regardless of how often clients send input
+    tick_rate = get_setting_int("tick_rate");
+    if (tick_rate <= 0) {
+        tick_rate = 60;
+    }
+    SDL_Thread* net_thread = SDL_CreateThread(network_thread, "NetworkThread", NULL);
+    const float tick_time = 1.0f / tick_rate;
+    const Uint64 counter_frequency = SDL_GetPerformanceFrequency();
+    const Uint64 tick_duration = counter_frequency / tick_rate;
+    Uint64 next_tick = SDL_GetPerformanceCounter();
 
     while (1) {
-        Uint32 currentTickTime = SDL_GetTicks();
-        delta_time = fmin(((currentTickTime - lastTickTime) / 1000.0f), 0.1f);
-
-        TCPsocket client_socket = SDLNet_TCP_Accept(server_socket);
-        if (client_socket) {
-            Player* player = add_new_player(&game_state, &world);
-            if (player) {
-                printf("Client connected!\n");
-
-                // Create a new thread to handle the client connection
-                ClientData* client_data = (ClientData*)malloc(sizeof(ClientData));
-                client_data->socket = client_socket;
-                client_data->player = player;
-                client_data->game_state = &game_state;
-                client_data->world = &world;
-                client_data->game_state_mutex = game_state_mutex;
-                client_data->delta_time = &delta_time;
-                client_threads[player->id] = SDL_CreateThread(handle_client, "ClientThread", (void*)client_data);
-            } else {
-                printf("Server is full. Client connection rejected.\n");
-                SDLNet_TCP_Close(client_socket);
-            }
+        Uint64 now = SDL_GetPerformanceCounter();
+        int ticks_run = 0;
+        while (now >= next_tick && ticks_run < MAX_CATCHUP_TICKS) {
+            run_tick(&game_state, tick_time);
+            next_tick += tick_duration;
+            ticks_run++;
         }
-
-        // Cap the tick rate
-        Uint32 elapsedTime = SDL_GetTicks() - currentTickTime;
-        if (elapsedTime < targetTickTime) {
-            SDL_Delay(targetTickTime - elapsedTime);
+        if (now >= next_tick) {
+            // Too far behind to catch up, drop the backlog instead of spiralling
+            next_tick = now + tick_duration;
+        }
+        if (ticks_run > 0) {
+            publish_snapshot(&game_state);
         }
 
-        lastTickTime = currentTickTime;
+        // Sleep until the next tick is due
+        now = SDL_GetPerformanceCounter();
+        if (next_tick > now) {
+            Uint32 sleep_ms = (Uint32)((next_tick - now) * 1000 / counter_frequency);
+            if (sleep_ms > 0) {
+                SDL_Delay(sleep_ms);
+            }
+        }
     }
 
+    SDL_WaitThread(net_thread, NULL);
+    for (int i = 0; i < max_players; i++) {
+        if (client_slots[i].state == SLOT_CONNECTED) {
+            SDLNet_TCP_Close(client_slots[i].stream.socket);
+            tcp_stream_free(&client_slots[i].stream);
+        }
+    }
+    SDLNet_FreeSocketSet(socket_set);
+    spsc_queue_free(&net_events);
+    for (int i = 0; i < max_players; i++) {
+        spsc_queue_free(&net_inputs[i]);
+    }
+    free(net_inputs);
+    free(connection_tokens);
+    free(client_slots);
+    free_game_logic();
+    job_system_shutdown();
+    game_state_free(&game_state);
+    free(world_chunk_message);
+    free(world_visibility_message);
+    free_world(&world);
+    SDLNet_UDP_Close(udp_socket);
     SDLNet_TCP_Close(server_socket);
     SDLNet_Quit();
     SDL_Quit();
 
-    // Clean up threads and mutex
-    for (int i = 0; i < game_state.players_count; i++) {
-        SDL_WaitThread(client_threads[i], NULL);
-    }
-    SDL_DestroyMutex(game_state_mutex);
-
     return 0;
 }
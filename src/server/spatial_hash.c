@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spatial_hash.h"
+
+static int get_bucket(const SpatialHash* hash, ivec3 cell);
+
+bool spatial_hash_init(SpatialHash* hash, int max_players) {
+    memset(hash, 0, sizeof(*hash));
+
+    // About two buckets per player keeps chains short
+    hash->bucket_count = 1;
+    while (hash->bucket_count < max_players * 2) {
+        hash->bucket_count *= 2;
+    }
+    hash->bucket_heads = malloc(sizeof(int) * hash->bucket_count);
+    hash->next = malloc(sizeof(int) * max_players);
+    hash->cells = malloc(sizeof(ivec3) * max_players);
+    if (!hash->bucket_heads || !hash->next || !hash->cells) {
+        printf("Failed to allocate spatial hash for %d players.\n", max_players);
+        spatial_hash_free(hash);
+        return false;
+    }
+    memset(hash->bucket_heads, -1, sizeof(int) * hash->bucket_count);
+    return true;
+}
+
+void spatial_hash_free(SpatialHash* hash) {
+    free(hash->bucket_heads);
+    free(hash->next);
+    free(hash->cells);
+    memset(hash, 0, sizeof(*hash));
+}
+
+void spatial_hash_rebuild(SpatialHash* hash, const GameState* game_state) {
+    memset(hash->bucket_heads, -1, sizeof(int) * hash->bucket_count);
+    hash->max_radius = 0.0f;
+
+    for (int i = 0; i < game_state->player_pool.count; i++) {
+        int id = game_state->player_pool.dense[i];
+        const Player* player = &game_state->players[id];
+        ivec3 cell = get_grid_pos3(player->position.x, player->position.y, player->position.z);
+        int bucket = get_bucket(hash, cell);
+        hash->cells[id] = cell;
+        hash->next[id] = hash->bucket_heads[bucket];
+        hash->bucket_heads[bucket] = id;
+        if (player->size > hash->max_radius) {
+            hash->max_radius = player->size;
+        }
+    }
+}
+
+int spatial_hash_query(const SpatialHash* hash, vec3 min, vec3 max, int* out_ids, int max_ids) {
+    float r = hash->max_radius;
+    ivec3 min_cell = get_grid_pos3(min.x - r, min.y - r, min.z - r);
+    ivec3 max_cell = get_grid_pos3(max.x + r, max.y + r, max.z + r);
+
+    int count = 0;
+    for (int z = min_cell.z; z <= max_cell.z; z++) {
+        for (int y = min_cell.y; y <= max_cell.y; y++) {
+            for (int x = min_cell.x; x <= max_cell.x; x++) {
+                ivec3 cell = { x, y, z };
+                for (int id = hash->bucket_heads[get_bucket(hash, cell)]; id >= 0; id = hash->next[id]) {
+                    // Other cells can share the bucket, only take players that are really in this one
+                    ivec3 player_cell = hash->cells[id];
+                    if (player_cell.x != x || player_cell.y != y || player_cell.z != z) {
+                        continue;
+                    }
+                    if (count >= max_ids) {
+                        return count;
+                    }
+                    out_ids[count++] = id;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+static int get_bucket(const SpatialHash* hash, ivec3 cell) {
+    Uint32 h = ((Uint32)cell.x * 73856093u) ^ ((Uint32)cell.y * 19349663u) ^ ((Uint32)cell.z * 83492791u);
+    return (int)(h & (Uint32)(hash->bucket_count - 1));
+}
@@ -0,0 +1,26 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <stdbool.h>
+#include "../shared/game.h"
+#include "../shared/vector.h"
+
+// Players bucketed by the grid cell they stand in (get_grid_pos3), rebuilt once per tick
+// so hit tests only look at players near a projectile.
+typedef struct SpatialHash {
+    int bucket_count; // Power of two
+    int* bucket_heads;
+    int* next;         // Per player id, the next player in the same bucket or -1
+    ivec3* cells;      // Per player id, the cell the player was inserted under
+    float max_radius;  // Largest player size inserted, queries are widened by it
+} SpatialHash;
+
+bool spatial_hash_init(SpatialHash* hash, int max_players);
+void spatial_hash_free(SpatialHash* hash);
+void spatial_hash_rebuild(SpatialHash* hash, const GameState* game_state);
+
+// Collects ids of players whose cell overlaps the box from min to max, widened by max_radius.
+// Returns the number written to out_ids, never more than max_ids.
+int spatial_hash_query(const SpatialHash* hash, vec3 min, vec3 max, int* out_ids, int max_ids);
+
+#endif // SPATIAL_HASH_H
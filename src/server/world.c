@@ -8,16 +8,38 @@
 #include "world.h"
 #include "../shared/utils.h"
 #include "../shared/vector.h"
+#include "../shared/occupancy.h"
+#include "../shared/chunk.h"
+#include "../shared/cell_definitions.h"
+#include "../shared/level_file.h"
 
-Cell* cell_definitions;
-int num_definitions;
-Cell default_cell;
+static int compare_layer_names(const void* a, const void* b);
 
 bool load_world(World* world, const char* level_name) {
+    // Load cell definitions, the client loads the same table so cells can be sent as indices into it
+    if (!load_cell_definitions("cell_definitions.txt")) {
+        return false;
+    }
+
+    // A compiled level is mapped as is, the bitmaps are only parsed when there is none
+    char level_path[256];
+    snprintf(level_path, sizeof(level_path), "levels/%s.level", level_name);
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (map_level_file(level_path, world)) {
+        double elapsed_ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+        printf("Mapped %dx%d world with %d layers in %d chunks from %s in %.1f ms.\n", world->width, world->height,
+               world->num_layers, count_world_chunks(world), level_path, elapsed_ms);
+        return true;
+    }
+    printf("Loading the level bitmaps instead, compile them with level_compiler to start faster.\n");
+    return load_world_from_bitmaps(world, level_name);
+}
+
+bool load_world_from_bitmaps(World* world, const char* level_name) {
     DIR* dir;
     struct dirent* entry;
     int layer_count = 0;
-    char leveldir[20];
+    char leveldir[256];
     snprintf(leveldir, sizeof(leveldir), "levels/%s", level_name);
     dir = opendir(leveldir);
     if (dir == NULL) {
@@ -25,161 +47,110 @@ bool load_world(World* world, const char* level_name) {
         return false;
     }
 
-    // Count the number of layer files
+    // Layers go bottom to top in file name order, whatever order the directory lists them in
+    char (*layer_names)[256] = malloc(sizeof(*layer_names) * MAX_LAYERS);
+    if (!layer_names) {
+        closedir(dir);
+        return false;
+    }
     while ((entry = readdir(dir)) != NULL) {
-        if (strstr(entry->d_name, ".bmp") != NULL) {
-            layer_count++;
+        if (strstr(entry->d_name, ".bmp") == NULL) {
+            continue;
         }
+        if (layer_count == MAX_LAYERS) {
+            printf("Too many layers in the level. Maximum allowed is %d.\n", MAX_LAYERS);
+            closedir(dir);
+            free(layer_names);
+            return false;
+        }
+        snprintf(layer_names[layer_count++], sizeof(*layer_names), "%s", entry->d_name);
     }
-
-    if (layer_count > MAX_LAYERS) {
-        printf("Too many layers in the level. Maximum allowed is %d.\n", MAX_LAYERS);
-        return false;
+    closedir(dir);
+    qsort(layer_names, layer_count, sizeof(*layer_names), compare_layer_names);
+
+    // Load every layer image first, the world is sized to fit the largest
+    SDL_Surface** layer_surfaces = calloc(layer_count > 0 ? layer_count : 1, sizeof(SDL_Surface*));
+    int loaded_layers = 0;
+    int width = 0;
+    int height = 0;
+    for (int i = 0; i < layer_count; i++) {
+        char layer_path[512];
+        snprintf(layer_path, sizeof(layer_path), "%s/%s", leveldir, layer_names[i]);
+        SDL_Surface* layer_surface = SDL_LoadBMP(layer_path);
+        if (layer_surface == NULL) {
+            printf("Failed to load layer %s at %s \n", layer_names[i], layer_path);
+            continue;
+        }
+        width = layer_surface->w > width ? layer_surface->w : width;
+        height = layer_surface->h > height ? layer_surface->h : height;
+        layer_surfaces[loaded_layers++] = layer_surface;
     }
+    free(layer_names);
 
-    // Allocate memory for layers
-    world->num_layers = layer_count;
-
-    // Reset directory position
-    rewinddir(dir);
-
-    default_cell.type = CELL_VOID;
-    SDL_Color cyan = {0, 255, 255};
-    default_cell.color = cyan;
-
-    // Load cell definitions
-    num_definitions = 0;
-    cell_definitions = read_cell_definitions("cell_definitions.txt", &num_definitions);
-
-    // Load each layer
-    int layer_index = 0;
-    while ((entry = readdir(dir)) != NULL) {
-        if (strstr(entry->d_name, ".bmp") != NULL) {
-            char layer_path[256];
-            snprintf(layer_path, sizeof(layer_path), "%s/%s", leveldir, entry->d_name);
-            SDL_Surface* layer_surface = SDL_LoadBMP(layer_path);
-            if (layer_surface == NULL) {
-                printf("Failed to load layer %s at %s \n", entry->d_name, layer_path);
-                continue;
-            }
-
-            parse_layer_from_surface(layer_surface, &world->layers[layer_index]);
-            SDL_FreeSurface(layer_surface);
-            layer_index++;
+    bool loaded = world_init(world, width, height, loaded_layers);
+    for (int i = 0; i < loaded_layers; i++) {
+        if (loaded && !parse_layer_from_surface(layer_surfaces[i], world, i)) {
+            world_free(world);
+            loaded = false;
         }
+        SDL_FreeSurface(layer_surfaces[i]);
+    }
+    free(layer_surfaces);
+    if (!loaded) {
+        return false;
     }
 
-    closedir(dir);
+    // Collision only ever needs a few bits per cell, derive them once here
+    build_world_occupancy(world);
+    printf("Loaded %dx%d world with %d layers in %d chunks.\n", width, height, loaded_layers, count_world_chunks(world));
     return true;
 }
 
 void free_world(World* world) {
-    // No need to free cells or layers, as they are now fixed-size arrays
-    world->num_layers = 0;
-
-    // Free cell_definitions if necessary
-    free(cell_definitions);
-    cell_definitions = NULL;
-}
-
-void parse_layer_from_surface(SDL_Surface* surface, Layer* layer) {
-    layer->width = surface->w;
-    layer->height = surface->h;
-
-    for (int y = 0; y < layer->height; ++y) {
-        for (int x = 0; x < layer->width; ++x) {
-            Uint8 r, g, b;
-            SDL_GetRGB(get_pixel32(surface, x, y), surface->format, &r, &g, &b);
-            SDL_Color color = {r, g, b, 255};
-       
-            layer->cells[y][x] = *get_cell_definition_from_color(color, cell_definitions, num_definitions);
-        }
-    }
-}
-
-Cell* get_cell_definition_from_color(SDL_Color color, Cell* definitions, int num_definitions) {
-    for (int i = 0; i < num_definitions; i++) {
-        Cell* def = &definitions[i];
-        if (color.r == def->color.r && color.g == def->color.g && color.b == def->color.b) {
-            return def;
-        }
+    if (world->level_file) {
+        unmap_level_file(world);
+    } else {
+        world_free(world);
     }
-    return &default_cell;
 }
 
-Cell* read_cell_definitions(const char* filename, int* num_definitions) {
-    FILE* file = fopen(filename, "r");
-    if (file == NULL) {
-        printf("Error: Cannot open cell definitions file: %s\n", filename);
-        return NULL;
+bool parse_layer_from_surface(SDL_Surface* surface, World* world, int layer) {
+    // Convert the whole layer once so every pixel reads as 0x00RRGGBB whatever the bitmap's format
+    SDL_Surface* rgb_surface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB888, 0);
+    if (rgb_surface == NULL) {
+        printf("Error: Failed to convert layer %d: %s\n", layer, SDL_GetError());
+        return false;
     }
+    SDL_LockSurface(rgb_surface);
+
+    for (int y = 0; y < rgb_surface->h; ++y) {
+        const Uint32* row = (const Uint32*)((const Uint8*)rgb_surface->pixels + y * rgb_surface->pitch);
+        // Levels are mostly long runs of one color, skip the lookup while it repeats
+        Uint32 last_rgb = 0xFFFFFFFF;
+        Cell cell = { 0 };
+        for (int x = 0; x < rgb_surface->w; ++x) {
+            Uint32 rgb = row[x] & 0xFFFFFF;
+            if (rgb != last_rgb) {
+                last_rgb = rgb;
+                cell = get_cell_from_rgb(rgb);
+            }
 
-    int capacity = 10;
-    Cell* definitions = (Cell *)malloc(capacity * sizeof(Cell));
-    *num_definitions = 0;
-    
-    char line[256];
-    while (fgets(line, sizeof(line), file) != NULL) {
-        // Skip comment lines
-        if (line[0] == '#') {
-            continue;
-        }
-
-        // Check if we need to expand the capacity of the array
-        if (*num_definitions >= capacity) {
-            capacity *= 2;
-            definitions = (Cell *)realloc(definitions, capacity * sizeof(Cell));
-        }
-
-        // Read and process the line
-        Cell* def = &definitions[*num_definitions];
-        if (parse_cell_definition(line, def)) {
-            // Increment the index only if the line was processed successfully
-            (*num_definitions)++;
+            // Void cells are the default, only chunks with something in them get allocated
+            if (get_cell_type(cell) == CELL_VOID) {
+                continue;
+            }
+            Chunk* chunk = get_or_create_chunk(world, x >> CHUNK_SHIFT, y >> CHUNK_SHIFT);
+            if (chunk) {
+                *get_chunk_cell(chunk, layer, x & CHUNK_MASK, y & CHUNK_MASK) = cell;
+            }
         }
     }
 
-    fclose(file);
-    return definitions;
+    SDL_UnlockSurface(rgb_surface);
+    SDL_FreeSurface(rgb_surface);
+    return true;
 }
 
-int parse_cell_definition(const char* line, Cell* def) {
-    unsigned int r, g, b;
-    char type_str[32];
-    char c_str[32], f_str[32], w_str[32], name_str[64];
-    int cx, cy, cw, ch, fx, fy, fw, fh, wx, wy, ww, wh;
-
-    int num_parsed = sscanf(line, " %02X%02X%02X %31s %31s %31s %31s %255[^\n]",
-                            &r, &g, &b,
-                            type_str,
-                            c_str,
-                            f_str,
-                            w_str,
-                            name_str);
-
-    if (num_parsed == 8) {
-        def->color.r = (Uint8)r;
-        def->color.g = (Uint8)g;
-        def->color.b = (Uint8)b;
-
-        if (strcmp(type_str, "SOLID") == 0) {
-            def->type = CELL_SOLID;
-        } else if (strcmp(type_str, "ROOM") == 0) {
-            def->type = CELL_ROOM;
-        } else if (strcmp(type_str, "FLOOR") == 0) {
-            def->type = CELL_FLOOR;
-        } else if (strcmp(type_str, "VOID") == 0) {
-            def->type = CELL_VOID;
-        } else {
-            printf("Error: Invalid cell type: %s\n", type_str);
-            return 0;
-        }
-
-        //printf("Loaded cell definition: %s\n", name_str);
-
-        return 1;
-    }
-
-    printf("Error: Invalid cell definition line: %s\n", line);
-    return 0;
+static int compare_layer_names(const void* a, const void* b) {
+    return strcmp((const char*)a, (const char*)b);
 }
@@ -7,14 +7,10 @@
 #include "../shared/game.h"
 #include "../shared/vector.h"
 
+// Maps levels/<name>.level if it has been compiled, otherwise parses the layer bitmaps in levels/<name>/
 bool load_world(World* world, const char* level_name);
+bool load_world_from_bitmaps(World* world, const char* level_name);
 void free_world(World* world);
-void parse_layer_from_surface(SDL_Surface* surface, Layer* layer);
-int parse_cell_definition(const char* line, Cell* def);
-Cell* get_cell_definition_from_color(SDL_Color color, Cell* definitions, int num_definitions);
-Cell* read_cell_definitions(const char* filename, int* num_definitions);
-bool is_out_of_xy_bounds(Layer* layer, int x, int y);
-bool is_within_xy_bounds(Layer* layer, int x, int y);
-bool get_world_cell(World* world, ivec3 grid_position, Cell** out_cell);
+bool parse_layer_from_surface(SDL_Surface* surface, World* world, int layer);
 
 #endif // WORLD_H
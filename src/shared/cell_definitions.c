@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "cell_definitions.h"
+
+// Entries past the count stay zeroed, which reads as void
+static CellDefinition definitions[MAX_CELL_DEFINITIONS];
+static int definition_count = 0;
+
+// Open addressing hash from 24 bit color to definition, at most half full so probes stay short.
+// Keys carry COLOR_KEY_USED so that black is distinguishable from an empty slot.
+#define COLOR_TABLE_BITS 9
+#define COLOR_TABLE_SIZE (1 << COLOR_TABLE_BITS)
+#define COLOR_KEY_USED 0x01000000u
+static Uint32 color_keys[COLOR_TABLE_SIZE];
+static Uint8 color_definitions[COLOR_TABLE_SIZE];
+
+static bool parse_cell_definition(const char* line, CellDefinition* out_definition);
+static void build_color_table();
+static Uint32 hash_color(Uint32 rgb);
+static SDL_Rect parse_atlas_rect(const char* text);
+
+bool load_cell_definitions(const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        printf("Error: Cannot open cell definitions file: %s\n", filename);
+        return false;
+    }
+
+    memset(definitions, 0, sizeof(definitions));
+    definitions[0] = (CellDefinition) {
+        .type = CELL_VOID,
+        .color = {0, 255, 255, 255},
+        .name = "Void"
+    };
+    definition_count = 1;
+
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        // Skip comments and empty lines
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+        if (definition_count == MAX_CELL_DEFINITIONS) {
+            printf("Error: More than %d cell definitions in %s\n", MAX_CELL_DEFINITIONS - 1, filename);
+            fclose(file);
+            return false;
+        }
+        if (parse_cell_definition(line, &definitions[definition_count])) {
+            definition_count++;
+        }
+    }
+
+    fclose(file);
+    build_color_table();
+    return true;
+}
+
+int get_cell_definition_count() {
+    return definition_count;
+}
+
+const CellDefinition* get_cell_definition(Cell cell) {
+    return &definitions[cell.definition];
+}
+
+CellType get_cell_type(Cell cell) {
+    return definitions[cell.definition].type;
+}
+
+Cell get_cell_from_color(SDL_Color color) {
+    return get_cell_from_rgb((Uint32)color.r << 16 | (Uint32)color.g << 8 | color.b);
+}
+
+Cell get_cell_from_rgb(Uint32 rgb) {
+    Uint32 key = (rgb & 0xFFFFFF) | COLOR_KEY_USED;
+    for (Uint32 slot = hash_color(rgb);; slot = (slot + 1) & (COLOR_TABLE_SIZE - 1)) {
+        if (color_keys[slot] == key) {
+            return (Cell) { color_definitions[slot] };
+        }
+        if (color_keys[slot] == 0) {
+            return (Cell) { 0 };
+        }
+    }
+}
+
+Uint32 get_cell_definitions_checksum() {
+    // FNV-1a
+    Uint32 hash = 2166136261u;
+    for (int i = 0; i < definition_count; i++) {
+        Uint8 bytes[4] = { (Uint8)definitions[i].type, definitions[i].color.r, definitions[i].color.g, definitions[i].color.b };
+        for (int j = 0; j < 4; j++) {
+            hash = (hash ^ bytes[j]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+static void build_color_table() {
+    memset(color_keys, 0, sizeof(color_keys));
+    memset(color_definitions, 0, sizeof(color_definitions));
+    for (int i = 1; i < definition_count; i++) {
+        const SDL_Color color = definitions[i].color;
+        Uint32 rgb = (Uint32)color.r << 16 | (Uint32)color.g << 8 | color.b;
+        Uint32 slot = hash_color(rgb);
+        while (color_keys[slot] != 0 && color_keys[slot] != (rgb | COLOR_KEY_USED)) {
+            slot = (slot + 1) & (COLOR_TABLE_SIZE - 1);
+        }
+        // When two definitions share a color the first one wins
+        if (color_keys[slot] == 0) {
+            color_keys[slot] = rgb | COLOR_KEY_USED;
+            color_definitions[slot] = (Uint8)i;
+        }
+    }
+}
+
+static Uint32 hash_color(Uint32 rgb) {
+    // Fibonacci hashing, the top bits index the table
+    return ((rgb & 0xFFFFFF) * 2654435769u) >> (32 - COLOR_TABLE_BITS);
+}
+
+static bool parse_cell_definition(const char* line, CellDefinition* out_definition) {
+    unsigned int r, g, b;
+    char type_str[32];
+    char c_str[32], f_str[32], w_str[32], name_str[64];
+
+    int num_parsed = sscanf(line, " %02X%02X%02X %31s %31s %31s %31s %63[^\n]",
+                            &r, &g, &b,
+                            type_str,
+                            c_str,
+                            f_str,
+                            w_str,
+                            name_str);
+    if (num_parsed != 8) {
+        printf("Error: Invalid cell definition line: %s\n", line);
+        return false;
+    }
+
+    if (strcmp(type_str, "SOLID") == 0) {
+        out_definition->type = CELL_SOLID;
+    } else if (strcmp(type_str, "ROOM") == 0) {
+        out_definition->type = CELL_ROOM;
+    } else if (strcmp(type_str, "FLOOR") == 0) {
+        out_definition->type = CELL_FLOOR;
+    } else if (strcmp(type_str, "VOID") == 0) {
+        out_definition->type = CELL_VOID;
+    } else {
+        printf("Error: Invalid cell type: %s\n", type_str);
+        return false;
+    }
+    out_definition->color = (SDL_Color) {(Uint8)r, (Uint8)g, (Uint8)b, 255};
+    out_definition->ceiling = parse_atlas_rect(c_str);
+    out_definition->floor = parse_atlas_rect(f_str);
+    out_definition->wall = parse_atlas_rect(w_str);
+    snprintf(out_definition->name, sizeof(out_definition->name), "%s", name_str);
+    return true;
+}
+
+// "X,Y,W,H", anything else (the files use "0") means no texture
+static SDL_Rect parse_atlas_rect(const char* text) {
+    SDL_Rect rect = {0, 0, 0, 0};
+    if (sscanf(text, "%d,%d,%d,%d", &rect.x, &rect.y, &rect.w, &rect.h) != 4) {
+        return (SDL_Rect) {0, 0, 0, 0};
+    }
+    return rect;
+}
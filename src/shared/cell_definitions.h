@@ -0,0 +1,34 @@
+#ifndef CELL_DEFINITIONS_H
+#define CELL_DEFINITIONS_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "game.h"
+
+// Cells are one byte indices into this table, so it holds at most 256 entries including void
+#define MAX_CELL_DEFINITIONS 256
+
+typedef struct CellDefinition {
+    CellType type;
+    SDL_Color color;    // Pixel color in level bitmaps
+    SDL_Rect ceiling;   // Texture atlas regions, zero sized when there is none
+    SDL_Rect floor;
+    SDL_Rect wall;
+    char name[64];
+} CellDefinition;
+
+// Server and client load the same cell_definitions.txt, entry 0 is void and the lines follow in file order
+bool load_cell_definitions(const char* filename);
+int get_cell_definition_count();
+const CellDefinition* get_cell_definition(Cell cell);
+CellType get_cell_type(Cell cell);
+
+// Level bitmap pixel to cell, void for colors without a definition. Constant time, the colors are hashed on load.
+Cell get_cell_from_color(SDL_Color color);
+// Same with the color packed as 0xRRGGBB, the upper byte is ignored
+Cell get_cell_from_rgb(Uint32 rgb);
+
+// Hash of the types, colors and order of the definitions so a client can tell it disagrees with the server
+Uint32 get_cell_definitions_checksum();
+
+#endif // CELL_DEFINITIONS_H
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "chunk.h"
+
+bool world_init(World* world, int width, int height, int num_layers) {
+    world->chunks = NULL;
+    world->level_file = NULL;
+    world->visibility = (Visibility) { 0 };
+    if (width < 1 || height < 1 || num_layers < 1 || width > MAX_WORLD_SIZE || height > MAX_WORLD_SIZE || num_layers > MAX_LAYERS) {
+        printf("Invalid world size %dx%dx%d.\n", width, height, num_layers);
+        return false;
+    }
+    world->width = width;
+    world->height = height;
+    world->num_layers = num_layers;
+    world->chunks_x = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    world->chunks_y = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    world->chunks = calloc(world->chunks_x * world->chunks_y, sizeof(Chunk*));
+    if (!world->chunks) {
+        printf("Failed to allocate world chunks.\n");
+        return false;
+    }
+    return true;
+}
+
+void world_free(World* world) {
+    if (world->chunks) {
+        for (int i = 0; i < world->chunks_x * world->chunks_y; i++) {
+            free(world->chunks[i]);
+        }
+        free(world->chunks);
+    }
+    free(world->visibility.bits);
+    world->visibility = (Visibility) { 0 };
+    world->chunks = NULL;
+    world->num_layers = 0;
+}
+
+Chunk* get_chunk(World* world, int chunk_x, int chunk_y) {
+    if (chunk_x < 0 || chunk_x >= world->chunks_x || chunk_y < 0 || chunk_y >= world->chunks_y) {
+        return NULL;
+    }
+    return world->chunks[chunk_y * world->chunks_x + chunk_x];
+}
+
+Chunk* get_or_create_chunk(World* world, int chunk_x, int chunk_y) {
+    Chunk* chunk = get_chunk(world, chunk_x, chunk_y);
+    if (chunk || chunk_x < 0 || chunk_x >= world->chunks_x || chunk_y < 0 || chunk_y >= world->chunks_y) {
+        return chunk;
+    }
+    chunk = create_chunk(world->num_layers);
+    if (!chunk) {
+        printf("Failed to allocate chunk %d,%d.\n", chunk_x, chunk_y);
+        return NULL;
+    }
+    world->chunks[chunk_y * world->chunks_x + chunk_x] = chunk;
+    return chunk;
+}
+
+Chunk* create_chunk(int num_layers) {
+    // One allocation per chunk, the arrays follow the header. Zeroed memory is all void cells with no obstacles.
+    size_t cells_size = sizeof(Cell) * num_layers * CHUNK_COLUMNS;
+    size_t rows_size = sizeof(Uint16) * num_layers * CHUNK_SIZE;
+    size_t obstacles_size = sizeof(Uint16) * num_layers * CHUNK_COLUMNS * 2;
+    Uint8* memory = calloc(1, sizeof(Chunk) + cells_size + rows_size + obstacles_size);
+    if (!memory) {
+        return NULL;
+    }
+    Chunk* chunk = (Chunk*)memory;
+    chunk->cells = (Cell*)(memory + sizeof(Chunk));
+    chunk->solid_rows = (Uint16*)(memory + sizeof(Chunk) + cells_size);
+    chunk->obstacles = (Uint16*)(memory + sizeof(Chunk) + cells_size + rows_size);
+    return chunk;
+}
+
+bool set_chunk(World* world, int chunk_x, int chunk_y, Chunk* chunk) {
+    if (chunk_x < 0 || chunk_x >= world->chunks_x || chunk_y < 0 || chunk_y >= world->chunks_y) {
+        return false;
+    }
+    Chunk** slot = &world->chunks[chunk_y * world->chunks_x + chunk_x];
+    if (*slot) {
+        return false;
+    }
+    *slot = chunk;
+    return true;
+}
+
+Cell* get_chunk_cell(Chunk* chunk, int layer, int local_x, int local_y) {
+    return &chunk->cells[(layer * CHUNK_SIZE + local_y) * CHUNK_SIZE + local_x];
+}
+
+int count_world_chunks(World* world) {
+    int count = 0;
+    for (int i = 0; i < world->chunks_x * world->chunks_y; i++) {
+        if (world->chunks[i]) {
+            count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,22 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <stdbool.h>
+#include "game.h"
+
+// Sets up an all-void world, chunks are allocated as cells are filled in
+bool world_init(World* world, int width, int height, int num_layers);
+void world_free(World* world);
+
+// O(1) lookup by chunk coordinates, NULL outside the world or where the chunk is all void
+Chunk* get_chunk(World* world, int chunk_x, int chunk_y);
+Chunk* get_or_create_chunk(World* world, int chunk_x, int chunk_y);
+
+// A detached chunk for a world with num_layers layers, freed by the world once set. Fails if the slot is taken.
+Chunk* create_chunk(int num_layers);
+bool set_chunk(World* world, int chunk_x, int chunk_y, Chunk* chunk);
+Cell* get_chunk_cell(Chunk* chunk, int layer, int local_x, int local_y);
+
+int count_world_chunks(World* world);
+
+#endif // CHUNK_H
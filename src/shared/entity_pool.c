@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "entity_pool.h"
+
+static void swap_positions(EntityPool* pool, int position_a, int position_b);
+
+bool entity_pool_init(EntityPool* pool, int capacity) {
+    pool->capacity = capacity;
+    pool->count = 0;
+    pool->dense = malloc(sizeof(int) * capacity);
+    pool->sparse = malloc(sizeof(int) * capacity);
+    if (!pool->dense || !pool->sparse) {
+        printf("Failed to allocate entity pool of %d.\n", capacity);
+        entity_pool_free(pool);
+        return false;
+    }
+    for (int i = 0; i < capacity; i++) {
+        pool->dense[i] = i;
+        pool->sparse[i] = i;
+    }
+    return true;
+}
+
+void entity_pool_free(EntityPool* pool) {
+    free(pool->dense);
+    free(pool->sparse);
+    pool->dense = NULL;
+    pool->sparse = NULL;
+    pool->capacity = 0;
+    pool->count = 0;
+}
+
+// Returns the allocated index, or -1 if the pool is full
+int entity_pool_alloc(EntityPool* pool) {
+    if (pool->count >= pool->capacity) {
+        return -1;
+    }
+    return pool->dense[pool->count++];
+}
+
+// Allocates a specific index, for entities whose index is decided elsewhere (player ids)
+bool entity_pool_alloc_index(EntityPool* pool, int index) {
+    if (index < 0 || index >= pool->capacity || entity_pool_is_live(pool, index)) {
+        return false;
+    }
+    swap_positions(pool, pool->sparse[index], pool->count);
+    pool->count++;
+    return true;
+}
+
+// Releasing moves the last live index into the freed position, so loops that release should run backwards
+void entity_pool_release(EntityPool* pool, int index) {
+    if (!entity_pool_is_live(pool, index)) {
+        return;
+    }
+    pool->count--;
+    swap_positions(pool, pool->sparse[index], pool->count);
+}
+
+bool entity_pool_is_live(const EntityPool* pool, int index) {
+    return index >= 0 && index < pool->capacity && pool->sparse[index] < pool->count;
+}
+
+void entity_pool_clear(EntityPool* pool) {
+    pool->count = 0;
+}
+
+static void swap_positions(EntityPool* pool, int position_a, int position_b) {
+    int index_a = pool->dense[position_a];
+    int index_b = pool->dense[position_b];
+    pool->dense[position_a] = index_b;
+    pool->dense[position_b] = index_a;
+    pool->sparse[index_b] = position_a;
+    pool->sparse[index_a] = position_b;
+}
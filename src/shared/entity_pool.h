@@ -0,0 +1,24 @@
+#ifndef ENTITY_POOL_H
+#define ENTITY_POOL_H
+
+#include <stdbool.h>
+
+// Tracks which indices of a fixed-size entity array are in use.
+// dense[0..count) lists the live indices in no particular order and the rest of dense is the free list,
+// so allocating, releasing and looking up an index are all O(1) and loops only touch live entities.
+typedef struct EntityPool {
+    int capacity;
+    int count;
+    int* dense;
+    int* sparse; // Position of each index within dense
+} EntityPool;
+
+bool entity_pool_init(EntityPool* pool, int capacity);
+void entity_pool_free(EntityPool* pool);
+int entity_pool_alloc(EntityPool* pool);
+bool entity_pool_alloc_index(EntityPool* pool, int index);
+void entity_pool_release(EntityPool* pool, int index);
+bool entity_pool_is_live(const EntityPool* pool, int index);
+void entity_pool_clear(EntityPool* pool);
+
+#endif // ENTITY_POOL_H
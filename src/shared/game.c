@@ -1,4 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "game.h"
 
 const int CELL_XY_SCALE = 2;
-const int CELL_Z_SCALE = 4;
\ No newline at end of file
+const int CELL_Z_SCALE = 4;
+
+static bool allocate_projectiles(Projectiles* projectiles, int capacity);
+static void free_projectiles(Projectiles* projectiles);
+static void move_projectile(Projectiles* projectiles, int from, int to);
+
+bool game_state_init(GameState* game_state, int max_players, int max_projectiles) {
+    memset(game_state, 0, sizeof(*game_state));
+    game_state->max_players = max_players;
+    game_state->max_projectiles = max_projectiles;
+    game_state->players = calloc(max_players, sizeof(Player));
+    if (!game_state->players || !allocate_projectiles(&game_state->projectiles, max_projectiles) ||
+        !entity_pool_init(&game_state->player_pool, max_players) ||
+        !entity_pool_init(&game_state->projectile_pool, max_projectiles)) {
+        printf("Failed to allocate game state for %d players and %d projectiles.\n", max_players, max_projectiles);
+        game_state_free(game_state);
+        return false;
+    }
+    for (int i = 0; i < max_players; i++) {
+        game_state->players[i].id = i;
+    }
+    return true;
+}
+
+void game_state_free(GameState* game_state) {
+    free(game_state->players);
+    free_projectiles(&game_state->projectiles);
+    entity_pool_free(&game_state->player_pool);
+    entity_pool_free(&game_state->projectile_pool);
+    game_state->players = NULL;
+}
+
+// Allocates a projectile, with the given network id or any free one if id is negative.
+// Returns its position in the projectile arrays, or -1 if there is no room. The fields are zeroed.
+int game_state_add_projectile(GameState* game_state, int id) {
+    EntityPool* pool = &game_state->projectile_pool;
+    if (id < 0) {
+        id = entity_pool_alloc(pool);
+    } else if (!entity_pool_alloc_index(pool, id)) {
+        id = -1;
+    }
+    if (id < 0) {
+        return -1;
+    }
+
+    int position = pool->count - 1;
+    Projectiles* projectiles = &game_state->projectiles;
+    projectiles->x[position] = projectiles->y[position] = projectiles->z[position] = 0.0f;
+    projectiles->previous_x[position] = projectiles->previous_y[position] = projectiles->previous_z[position] = 0.0f;
+    projectiles->direction_x[position] = projectiles->direction_y[position] = projectiles->direction_z[position] = 0.0f;
+    projectiles->velocity_x[position] = projectiles->velocity_y[position] = projectiles->velocity_z[position] = 0.0f;
+    projectiles->speed[position] = 0.0f;
+    projectiles->size[position] = 0.0f;
+    projectiles->owner[position] = 0;
+    projectiles->ttl[position] = 0;
+    projectiles->active[position] = false;
+    return position;
+}
+
+// Fills the hole with the last live projectile, so loops that remove should run backwards
+void game_state_remove_projectile(GameState* game_state, int position) {
+    EntityPool* pool = &game_state->projectile_pool;
+    if (position < 0 || position >= pool->count) {
+        return;
+    }
+    move_projectile(&game_state->projectiles, pool->count - 1, position);
+    entity_pool_release(pool, pool->dense[position]);
+}
+
+static bool allocate_projectiles(Projectiles* projectiles, int capacity) {
+    float** float_fields[] = {
+        &projectiles->x, &projectiles->y, &projectiles->z,
+        &projectiles->previous_x, &projectiles->previous_y, &projectiles->previous_z,
+        &projectiles->direction_x, &projectiles->direction_y, &projectiles->direction_z,
+        &projectiles->velocity_x, &projectiles->velocity_y, &projectiles->velocity_z,
+        &projectiles->speed, &projectiles->size
+    };
+    bool allocated = true;
+    for (int i = 0; i < (int)(sizeof(float_fields) / sizeof(float_fields[0])); i++) {
+        *float_fields[i] = calloc(capacity, sizeof(float));
+        allocated = allocated && *float_fields[i] != NULL;
+    }
+    projectiles->owner = calloc(capacity, sizeof(int));
+    projectiles->ttl = calloc(capacity, sizeof(int));
+    projectiles->active = calloc(capacity, sizeof(bool));
+    return allocated && projectiles->owner && projectiles->ttl && projectiles->active;
+}
+
+static void free_projectiles(Projectiles* projectiles) {
+    free(projectiles->x);
+    free(projectiles->y);
+    free(projectiles->z);
+    free(projectiles->previous_x);
+    free(projectiles->previous_y);
+    free(projectiles->previous_z);
+    free(projectiles->direction_x);
+    free(projectiles->direction_y);
+    free(projectiles->direction_z);
+    free(projectiles->velocity_x);
+    free(projectiles->velocity_y);
+    free(projectiles->velocity_z);
+    free(projectiles->speed);
+    free(projectiles->size);
+    free(projectiles->owner);
+    free(projectiles->ttl);
+    free(projectiles->active);
+    memset(projectiles, 0, sizeof(*projectiles));
+}
+
+static void move_projectile(Projectiles* projectiles, int from, int to) {
+    projectiles->x[to] = projectiles->x[from];
+    projectiles->y[to] = projectiles->y[from];
+    projectiles->z[to] = projectiles->z[from];
+    projectiles->previous_x[to] = projectiles->previous_x[from];
+    projectiles->previous_y[to] = projectiles->previous_y[from];
+    projectiles->previous_z[to] = projectiles->previous_z[from];
+    projectiles->direction_x[to] = projectiles->direction_x[from];
+    projectiles->direction_y[to] = projectiles->direction_y[from];
+    projectiles->direction_z[to] = projectiles->direction_z[from];
+    projectiles->velocity_x[to] = projectiles->velocity_x[from];
+    projectiles->velocity_y[to] = projectiles->velocity_y[from];
+    projectiles->velocity_z[to] = projectiles->velocity_z[from];
+    projectiles->speed[to] = projectiles->speed[from];
+    projectiles->size[to] = projectiles->size[from];
+    projectiles->owner[to] = projectiles->owner[from];
+    projectiles->ttl[to] = projectiles->ttl[from];
+    projectiles->active[to] = projectiles->active[from];
+}
@@ -3,13 +3,21 @@
 
 #include <stdbool.h>
 #include "vector.h"
+#include "entity_pool.h"
 
-#define MAX_PROJECTILES 64
-#define MAX_LAYERS 6
-#define MAX_WIDTH 32
-#define MAX_HEIGHT 32
-#define MAX_PLAYERS 4
-#define MAX_CLIENTS 4
+// Upper bounds for the entity pools, which are sized from server.txt
+#define MAX_PLAYERS 256
+#define MAX_PROJECTILES 1024
+
+// Sanity bounds for level and network data, the world itself is sized from the level
+#define MAX_WORLD_SIZE 4096
+#define MAX_LAYERS 256
+
+// Cells are stored in chunks of CHUNK_SIZE x CHUNK_SIZE columns through every layer
+#define CHUNK_SHIFT 4
+#define CHUNK_SIZE (1 << CHUNK_SHIFT)
+#define CHUNK_MASK (CHUNK_SIZE - 1)
+#define CHUNK_COLUMNS (CHUNK_SIZE * CHUNK_SIZE)
 
 #define PLAYER_HEALTH 6
 
@@ -30,17 +38,30 @@ typedef struct Player {
     bool free_mode;
     bool jumped;
     bool connected;
+    Uint32 last_input_sequence; // Newest input the simulation has applied for this player
 } Player;
 
-typedef struct Projectile {
-    vec3 position;
-    vec3 direction;
-    float speed;
-    float size;
-    int owner;
-    int ttl;
-    bool active;
-} Projectile;
+// Projectile fields as parallel arrays indexed by position in projectile_pool.dense, so live projectiles
+// are always packed at the front and per-tick updates stream through contiguous memory
+typedef struct Projectiles {
+    float* x;
+    float* y;
+    float* z;
+    float* previous_x; // Position at the start of the last update
+    float* previous_y;
+    float* previous_z;
+    float* direction_x;
+    float* direction_y;
+    float* direction_z;
+    float* velocity_x; // direction * speed while active, zero once the projectile has hit something
+    float* velocity_y;
+    float* velocity_z;
+    float* speed;
+    float* size;
+    int* owner;
+    int* ttl;
+    bool* active;
+} Projectiles;
 
 typedef struct MouseState {
     int x, y;
@@ -53,7 +74,9 @@ typedef struct ButtonState {
 } ButtonState;
 
 typedef struct InputState {
+    Uint32 sequence;
     MouseState mouse_state;
+    float delta_time; // Client frame time this input covers, in seconds
     union
     {
         ButtonState Buttons[11];
@@ -81,31 +104,73 @@ typedef enum {
     CELL_FLOOR
 } CellType;
 
-typedef struct {
-    CellType type;
-    SDL_Color color;
+// Index into the cell definition table loaded from cell_definitions.txt, see cell_definitions.h. 0 is void.
+typedef struct Cell {
+    Uint8 definition;
 } Cell;
 
+// A chunk is only allocated once it holds a non-void cell. Collision occupancy is kept next to the cells so
+// hot loops never load a Cell: solid cells are one bit each, and every column lists the heights a player can't
+// pass in increasing order, encoded as 2 * layer for the bottom of a ceiling (room or solid) and
+// 2 * layer + 1 for the top of a floor (anything but void).
 typedef struct {
-    int width;
-    int height;
-    Cell cells[MAX_HEIGHT][MAX_WIDTH];
-} Layer;
+    Cell* cells;        // [layer][y][x] within the chunk
+    Uint16* solid_rows; // [layer][y], bit x set when the cell is solid
+    Uint16* obstacles;  // Column y * CHUNK_SIZE + x owns obstacle_start[column] up to obstacle_start[column + 1]
+    int obstacle_start[CHUNK_COLUMNS + 1];
+} Chunk;
+
+// Which regions of the world may be seen from which, see visibility.h. A region is region_size x region_size
+// columns through every layer, and the table is one row of bits per region.
+typedef struct {
+    int region_size; // In cells, 0 when the world has no visibility data and everything counts as visible
+    int regions_x;
+    int regions_y;
+    int row_bytes;
+    Uint8* bits; // Bit b of row a is set when region b may be visible from region a
+} Visibility;
 
 typedef struct {
+    int width; // In cells
+    int height;
     int num_layers;
-    Layer layers[MAX_LAYERS];
+    int chunks_x;
+    int chunks_y;
+    float gravity;
+    Chunk** chunks; // chunks_x * chunks_y, NULL where every cell is void
+    void* level_file; // Set when the chunks point into a mapped level file, see level_file.h
+    Visibility visibility;
 } World;
 
 typedef struct GameState {
-    Player players[MAX_CLIENTS];
-    int players_count;
-    Projectile projectiles[MAX_PROJECTILES];
+    Uint32 tick;
+    int max_players;
+    Player* players;            // Indexed by player id
+    EntityPool player_pool;     // Connected players
+    int max_projectiles;
+    Projectiles projectiles;
+    EntityPool projectile_pool; // Projectiles with ttl left, dense[position] is the projectile's network id
 } GameState;
 
+// Followed on the TCP stream by world_chunk_count MESSAGE_WORLD_CHUNK frames, then a MESSAGE_WORLD_VISIBILITY
+// frame when the world has a visibility table
 typedef struct InitialGameState {
-    World world;
+    int world_width;
+    int world_height;
+    int world_layers;
+    int world_chunk_count;
+    Uint32 cell_definitions_checksum; // Cells are sent as definition indices, both sides must have the same table
+    float gravity;
     int player_id;
+    int max_players;
+    int max_projectiles;
+    Uint32 connection_token; // Identifies this connection's UDP packets
+    int tick_rate;
 } InitialGameState;
 
+bool game_state_init(GameState* game_state, int max_players, int max_projectiles);
+void game_state_free(GameState* game_state);
+int game_state_add_projectile(GameState* game_state, int id);
+void game_state_remove_projectile(GameState* game_state, int position);
+
 #endif // GAME_H
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_atomic.h>
+
+#include "job_system.h"
+
+#define JOB_QUEUE_CAPACITY 256
+
+typedef struct {
+    JobFunction function;
+    void* data;
+    int begin;
+    int end;
+} Job;
+
+// Owner pushes and pops at the bottom, thieves take from the top. Critical sections are a few
+// instructions long, so a spinlock per queue is cheaper than anything lock-free here.
+typedef struct {
+    SDL_SpinLock lock;
+    Job jobs[JOB_QUEUE_CAPACITY];
+    int top;
+    int bottom;
+} JobQueue;
+
+typedef struct {
+    SDL_Thread* thread;
+    int index;
+} Worker;
+
+static Worker* workers = NULL;
+static int thread_count = 0;
+static JobQueue* queues = NULL; // One per worker plus one for the calling thread, which is last
+static SDL_sem* wake_semaphore = NULL;
+static SDL_atomic_t running;
+static SDL_atomic_t pending_jobs;
+
+static void push_job(JobQueue* queue, const Job* job);
+static bool pop_job(JobQueue* queue, Job* out_job);
+static bool steal_job(JobQueue* queue, Job* out_job);
+static bool run_one_job(int worker_index);
+static int worker_main(void* data);
+
+bool job_system_init(int requested_threads) {
+    thread_count = requested_threads > 0 ? requested_threads : SDL_GetCPUCount() - 1;
+    if (thread_count < 0) {
+        thread_count = 0;
+    }
+
+    queues = calloc(thread_count + 1, sizeof(JobQueue));
+    workers = calloc(thread_count > 0 ? thread_count : 1, sizeof(Worker));
+    wake_semaphore = SDL_CreateSemaphore(0);
+    if (!queues || !workers || !wake_semaphore) {
+        printf("Failed to set up job system: %s\n", SDL_GetError());
+        job_system_shutdown();
+        return false;
+    }
+
+    SDL_AtomicSet(&running, 1);
+    SDL_AtomicSet(&pending_jobs, 0);
+    for (int i = 0; i < thread_count; i++) {
+        workers[i].index = i;
+        workers[i].thread = SDL_CreateThread(worker_main, "JobWorker", &workers[i]);
+        if (!workers[i].thread) {
+            printf("Failed to create job worker: %s\n", SDL_GetError());
+            thread_count = i;
+            break;
+        }
+    }
+    printf("Job system running with %d worker threads.\n", thread_count);
+    return true;
+}
+
+void job_system_shutdown() {
+    SDL_AtomicSet(&running, 0);
+    for (int i = 0; i < thread_count; i++) {
+        SDL_SemPost(wake_semaphore);
+    }
+    for (int i = 0; i < thread_count; i++) {
+        SDL_WaitThread(workers[i].thread, NULL);
+    }
+    if (wake_semaphore) {
+        SDL_DestroySemaphore(wake_semaphore);
+    }
+    free(workers);
+    free(queues);
+    workers = NULL;
+    queues = NULL;
+    wake_semaphore = NULL;
+    thread_count = 0;
+}
+
+int job_system_worker_count() {
+    return thread_count + 1;
+}
+
+void job_system_parallel_for(JobFunction function, void* data, int count, int batch_size) {
+    if (count <= 0) {
+        return;
+    }
+    int caller_index = thread_count;
+    if (thread_count == 0 || count <= batch_size) {
+        function(data, 0, count, caller_index);
+        return;
+    }
+
+    // Make batches big enough that they all fit in the queues
+    int max_batches = (thread_count + 1) * JOB_QUEUE_CAPACITY;
+    if (batch_size < 1 || (count + batch_size - 1) / batch_size > max_batches) {
+        batch_size = (count + max_batches - 1) / max_batches;
+    }
+    int batch_count = (count + batch_size - 1) / batch_size;
+
+    // Deal the batches out round robin so every queue starts with a share
+    SDL_AtomicAdd(&pending_jobs, batch_count);
+    for (int b = 0; b < batch_count; b++) {
+        int end = (b + 1) * batch_size;
+        Job job = { function, data, b * batch_size, end < count ? end : count };
+        push_job(&queues[b % (thread_count + 1)], &job);
+    }
+    for (int i = 0; i < thread_count; i++) {
+        SDL_SemPost(wake_semaphore);
+    }
+
+    // Work alongside the workers until every batch has finished
+    while (SDL_AtomicGet(&pending_jobs) > 0) {
+        run_one_job(caller_index);
+    }
+}
+
+static void push_job(JobQueue* queue, const Job* job) {
+    SDL_AtomicLock(&queue->lock);
+    queue->jobs[queue->bottom % JOB_QUEUE_CAPACITY] = *job;
+    queue->bottom++;
+    SDL_AtomicUnlock(&queue->lock);
+}
+
+static bool pop_job(JobQueue* queue, Job* out_job) {
+    bool found = false;
+    SDL_AtomicLock(&queue->lock);
+    if (queue->bottom > queue->top) {
+        queue->bottom--;
+        *out_job = queue->jobs[queue->bottom % JOB_QUEUE_CAPACITY];
+        found = true;
+    }
+    if (queue->bottom == queue->top) {
+        queue->bottom = queue->top = 0;
+    }
+    SDL_AtomicUnlock(&queue->lock);
+    return found;
+}
+
+static bool steal_job(JobQueue* queue, Job* out_job) {
+    bool found = false;
+    SDL_AtomicLock(&queue->lock);
+    if (queue->bottom > queue->top) {
+        *out_job = queue->jobs[queue->top % JOB_QUEUE_CAPACITY];
+        queue->top++;
+        found = true;
+    }
+    SDL_AtomicUnlock(&queue->lock);
+    return found;
+}
+
+// Runs a job from the worker's own queue, or failing that one stolen from another queue
+static bool run_one_job(int worker_index) {
+    Job job;
+    bool found = pop_job(&queues[worker_index], &job);
+    for (int i = 1; !found && i <= thread_count; i++) {
+        found = steal_job(&queues[(worker_index + i) % (thread_count + 1)], &job);
+    }
+    if (!found) {
+        return false;
+    }
+    job.function(job.data, job.begin, job.end, worker_index);
+    SDL_AtomicAdd(&pending_jobs, -1);
+    return true;
+}
+
+static int worker_main(void* data) {
+    Worker* worker = (Worker*)data;
+    while (1) {
+        SDL_SemWait(wake_semaphore);
+        if (!SDL_AtomicGet(&running)) {
+            break;
+        }
+        while (run_one_job(worker->index)) {
+        }
+    }
+    return 0;
+}
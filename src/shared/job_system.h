@@ -0,0 +1,22 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <stdbool.h>
+
+// Runs items [begin, end) of a parallel_for. worker_index is below job_system_worker_count()
+// and is unique among jobs running at the same time, so it can pick per-thread scratch space.
+typedef void (*JobFunction)(void* data, int begin, int end, int worker_index);
+
+// Starts thread_count background workers, or one per core but one when thread_count is 0.
+// With no workers, parallel_for simply runs everything on the calling thread.
+bool job_system_init(int thread_count);
+void job_system_shutdown();
+
+// Number of threads that can run jobs, including the thread calling parallel_for
+int job_system_worker_count();
+
+// Splits [0, count) into batches of at most batch_size, spreads them over the workers' queues and
+// returns once all of them have run. The calling thread works too; idle workers steal from busy ones.
+void job_system_parallel_for(JobFunction function, void* data, int count, int batch_size);
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "level_file.h"
+#include "chunk.h"
+#include "cell_definitions.h"
+#include "visibility.h"
+
+// Kept in world->level_file while the world points into the file
+typedef struct MappedLevel {
+    const Uint8* data;
+    size_t size;
+    Chunk* chunks; // One block of headers for every chunk in the file
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} MappedLevel;
+
+static size_t get_chunk_data_size(int num_layers, Uint32 obstacle_count);
+static Uint32 get_checksum(const Uint8* data, size_t size);
+static bool check_level(const char* path, const MappedLevel* level);
+static bool has_loaded_palette(const Uint8* palette, Uint32 palette_count);
+static bool map_chunks(MappedLevel* level, World* world);
+static bool map_visibility(const MappedLevel* level, World* world);
+static bool map_file(const char* path, MappedLevel* level);
+static void unmap_file(MappedLevel* level);
+
+bool write_level_file(const char* path, World* world) {
+    Uint32 palette_count = (Uint32)get_cell_definition_count();
+    Uint32 chunk_count = (Uint32)count_world_chunks(world);
+
+    // Size everything first so the file can be built, checksummed and written in one piece
+    size_t table_offset = sizeof(LevelFileHeader) + palette_count * 4;
+    size_t data_offset = table_offset + chunk_count * sizeof(LevelFileChunk);
+    size_t size = data_offset;
+    for (int i = 0; i < world->chunks_x * world->chunks_y; i++) {
+        if (world->chunks[i]) {
+            size += get_chunk_data_size(world->num_layers, world->chunks[i]->obstacle_start[CHUNK_COLUMNS]);
+        }
+    }
+    size_t visibility_offset = size;
+    size_t visibility_size = world->visibility.bits ? (size_t)get_visibility_table_size(&world->visibility) : 0;
+    size += (visibility_size + 3) & ~(size_t)3;
+    if (size > 0xFFFFFFFFu) {
+        printf("Level is too large for the level file format.\n");
+        return false;
+    }
+    Uint8* file_data = calloc(1, size);
+    if (!file_data) {
+        printf("Failed to allocate %zu bytes for the level file.\n", size);
+        return false;
+    }
+
+    Uint8* palette = file_data + sizeof(LevelFileHeader);
+    for (Uint32 i = 0; i < palette_count; i++) {
+        const CellDefinition* definition = get_cell_definition((Cell) { (Uint8)i });
+        palette[i * 4] = (Uint8)definition->type;
+        palette[i * 4 + 1] = definition->color.r;
+        palette[i * 4 + 2] = definition->color.g;
+        palette[i * 4 + 3] = definition->color.b;
+    }
+
+    LevelFileChunk* table = (LevelFileChunk*)(file_data + table_offset);
+    size_t cells_size = sizeof(Cell) * world->num_layers * CHUNK_COLUMNS;
+    size_t rows_size = sizeof(Uint16) * world->num_layers * CHUNK_SIZE;
+    size_t offset = data_offset;
+    for (int i = 0; i < world->chunks_x * world->chunks_y; i++) {
+        Chunk* chunk = world->chunks[i];
+        if (!chunk) {
+            continue;
+        }
+        Uint32 obstacle_count = (Uint32)chunk->obstacle_start[CHUNK_COLUMNS];
+        *table++ = (LevelFileChunk) {
+            .chunk_x = (Uint16)(i % world->chunks_x),
+            .chunk_y = (Uint16)(i / world->chunks_x),
+            .offset = (Uint32)offset,
+            .obstacle_count = obstacle_count
+        };
+        Uint8* out = file_data + offset;
+        memcpy(out, chunk->obstacle_start, sizeof(chunk->obstacle_start));
+        out += sizeof(chunk->obstacle_start);
+        memcpy(out, chunk->cells, cells_size);
+        out += cells_size;
+        memcpy(out, chunk->solid_rows, rows_size);
+        out += rows_size;
+        memcpy(out, chunk->obstacles, sizeof(Uint16) * obstacle_count);
+        offset += get_chunk_data_size(world->num_layers, obstacle_count);
+    }
+    if (visibility_size > 0) {
+        memcpy(file_data + visibility_offset, world->visibility.bits, visibility_size);
+    }
+
+    LevelFileHeader* header = (LevelFileHeader*)file_data;
+    *header = (LevelFileHeader) {
+        .magic = LEVEL_FILE_MAGIC,
+        .version = LEVEL_FILE_VERSION,
+        .width = (Uint32)world->width,
+        .height = (Uint32)world->height,
+        .num_layers = (Uint32)world->num_layers,
+        .palette_count = palette_count,
+        .chunk_count = chunk_count,
+        .visibility_region_size = visibility_size > 0 ? (Uint32)world->visibility.region_size : 0,
+        .visibility_offset = visibility_size > 0 ? (Uint32)visibility_offset : 0,
+        .payload_size = (Uint32)(size - sizeof(LevelFileHeader)),
+        .payload_checksum = get_checksum(file_data + sizeof(LevelFileHeader), size - sizeof(LevelFileHeader))
+    };
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        printf("Failed to open %s for writing.\n", path);
+        free(file_data);
+        return false;
+    }
+    bool written = fwrite(file_data, 1, size, file) == size;
+    written = fclose(file) == 0 && written;
+    free(file_data);
+    if (!written) {
+        printf("Failed to write %s.\n", path);
+    }
+    return written;
+}
+
+bool map_level_file(const char* path, World* world) {
+    MappedLevel* level = calloc(1, sizeof(MappedLevel));
+    if (!level) {
+        return false;
+    }
+    if (!map_file(path, level)) {
+        free(level);
+        return false;
+    }
+    const LevelFileHeader* header = (const LevelFileHeader*)level->data;
+    if (!check_level(path, level) || !world_init(world, (int)header->width, (int)header->height, (int)header->num_layers)) {
+        unmap_file(level);
+        free(level);
+        return false;
+    }
+    world->level_file = level;
+    if (!map_chunks(level, world)) {
+        printf("%s has invalid chunks.\n", path);
+        unmap_level_file(world);
+        return false;
+    }
+    if (!map_visibility(level, world)) {
+        printf("%s has an invalid visibility table.\n", path);
+        unmap_level_file(world);
+        return false;
+    }
+    return true;
+}
+
+void unmap_level_file(World* world) {
+    MappedLevel* level = world->level_file;
+    if (!level) {
+        return;
+    }
+    // The table points into one block of headers, not at chunks of their own
+    free(world->chunks);
+    world->chunks = NULL;
+    world->num_layers = 0;
+    world->level_file = NULL;
+    world->visibility = (Visibility) { 0 };
+    free(level->chunks);
+    unmap_file(level);
+    free(level);
+}
+
+static size_t get_chunk_data_size(int num_layers, Uint32 obstacle_count) {
+    size_t size = sizeof(int) * (CHUNK_COLUMNS + 1) +
+                  sizeof(Cell) * num_layers * CHUNK_COLUMNS +
+                  sizeof(Uint16) * num_layers * CHUNK_SIZE +
+                  sizeof(Uint16) * obstacle_count;
+    return (size + 3) & ~(size_t)3;
+}
+
+static Uint32 get_checksum(const Uint8* data, size_t size) {
+    // FNV-1a
+    Uint32 hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool check_level(const char* path, const MappedLevel* level) {
+    const LevelFileHeader* header = (const LevelFileHeader*)level->data;
+    if (level->size < sizeof(LevelFileHeader) || header->magic != LEVEL_FILE_MAGIC || header->version != LEVEL_FILE_VERSION ||
+        header->payload_size != level->size - sizeof(LevelFileHeader)) {
+        printf("%s is not a version %d level file.\n", path, LEVEL_FILE_VERSION);
+        return false;
+    }
+    if (get_checksum(level->data + sizeof(LevelFileHeader), header->payload_size) != header->payload_checksum) {
+        printf("%s is corrupt.\n", path);
+        return false;
+    }
+    // The cells are indices into the palette, which has to be the table clients load
+    if (header->palette_count * 4 > header->payload_size ||
+        !has_loaded_palette(level->data + sizeof(LevelFileHeader), header->palette_count)) {
+        printf("%s was compiled with different cell definitions, recompile it.\n", path);
+        return false;
+    }
+    return true;
+}
+
+static bool has_loaded_palette(const Uint8* palette, Uint32 palette_count) {
+    if (palette_count != (Uint32)get_cell_definition_count()) {
+        return false;
+    }
+    for (Uint32 i = 0; i < palette_count; i++) {
+        const CellDefinition* definition = get_cell_definition((Cell) { (Uint8)i });
+        if (palette[i * 4] != (Uint8)definition->type || palette[i * 4 + 1] != definition->color.r ||
+            palette[i * 4 + 2] != definition->color.g || palette[i * 4 + 3] != definition->color.b) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool map_chunks(MappedLevel* level, World* world) {
+    const LevelFileHeader* header = (const LevelFileHeader*)level->data;
+    size_t table_offset = sizeof(LevelFileHeader) + header->palette_count * 4;
+    size_t data_offset = table_offset + (size_t)header->chunk_count * sizeof(LevelFileChunk);
+    if (header->chunk_count > (Uint32)(world->chunks_x * world->chunks_y) || data_offset > level->size) {
+        return false;
+    }
+    level->chunks = calloc(header->chunk_count > 0 ? header->chunk_count : 1, sizeof(Chunk));
+    if (!level->chunks) {
+        return false;
+    }
+
+    const LevelFileChunk* table = (const LevelFileChunk*)(level->data + table_offset);
+    size_t cells_size = sizeof(Cell) * world->num_layers * CHUNK_COLUMNS;
+    size_t rows_size = sizeof(Uint16) * world->num_layers * CHUNK_SIZE;
+    for (Uint32 i = 0; i < header->chunk_count; i++) {
+        const LevelFileChunk* entry = &table[i];
+        if (entry->offset < data_offset || entry->offset % 4 != 0 || entry->obstacle_count > (Uint32)(world->num_layers * CHUNK_COLUMNS * 2) ||
+            entry->offset + get_chunk_data_size(world->num_layers, entry->obstacle_count) > level->size) {
+            return false;
+        }
+        Chunk* chunk = &level->chunks[i];
+        if (!set_chunk(world, entry->chunk_x, entry->chunk_y, chunk)) {
+            return false;
+        }
+        // Only the column starts are copied, they live inside the header; the rest is used in place
+        const Uint8* data = level->data + entry->offset;
+        memcpy(chunk->obstacle_start, data, sizeof(chunk->obstacle_start));
+        data += sizeof(chunk->obstacle_start);
+        chunk->cells = (Cell*)data;
+        data += cells_size;
+        chunk->solid_rows = (Uint16*)data;
+        data += rows_size;
+        chunk->obstacles = (Uint16*)data;
+        if (chunk->obstacle_start[0] != 0 || chunk->obstacle_start[CHUNK_COLUMNS] != (int)entry->obstacle_count) {
+            return false;
+        }
+        // The column starts index the obstacles directly, so a file that passed the checksum but came from a
+        // broken compiler or an editor must not get them out of order; in order they stay within the count
+        for (int column = 0; column < CHUNK_COLUMNS; column++) {
+            if (chunk->obstacle_start[column + 1] < chunk->obstacle_start[column]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool map_visibility(const MappedLevel* level, World* world) {
+    const LevelFileHeader* header = (const LevelFileHeader*)level->data;
+    if (header->visibility_region_size == 0) {
+        return true;
+    }
+    // The compiler always picks the smallest region size that fits, which bounds the table
+    int region_size = (int)header->visibility_region_size;
+    if (region_size != get_visibility_region_size(world->width, world->height)) {
+        return false;
+    }
+    Visibility* visibility = &world->visibility;
+    visibility->region_size = region_size;
+    visibility->regions_x = (world->width + region_size - 1) / region_size;
+    visibility->regions_y = (world->height + region_size - 1) / region_size;
+    visibility->row_bytes = (visibility->regions_x * visibility->regions_y + 7) / 8;
+    if (header->visibility_offset < sizeof(LevelFileHeader) ||
+        header->visibility_offset + (size_t)get_visibility_table_size(visibility) > level->size) {
+        *visibility = (Visibility) { 0 };
+        return false;
+    }
+    visibility->bits = (Uint8*)(level->data + header->visibility_offset);
+    return true;
+}
+
+#ifdef _WIN32
+static bool map_file(const char* path, MappedLevel* level) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        printf("No compiled level at %s.\n", path);
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        printf("%s is empty.\n", path);
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!data) {
+        printf("Failed to map %s.\n", path);
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return false;
+    }
+    level->data = data;
+    level->size = (size_t)size.QuadPart;
+    level->file = file;
+    level->mapping = mapping;
+    return true;
+}
+
+static void unmap_file(MappedLevel* level) {
+    UnmapViewOfFile(level->data);
+    CloseHandle(level->mapping);
+    CloseHandle(level->file);
+}
+#else
+static bool map_file(const char* path, MappedLevel* level) {
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        printf("No compiled level at %s.\n", path);
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0) {
+        printf("%s is empty.\n", path);
+        close(file);
+        return false;
+    }
+    // The mapping stays valid after the descriptor is closed
+    void* data = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED) {
+        printf("Failed to map %s.\n", path);
+        return false;
+    }
+    level->data = data;
+    level->size = (size_t)file_stat.st_size;
+    return true;
+}
+
+static void unmap_file(MappedLevel* level) {
+    munmap((void*)level->data, level->size);
+}
+#endif
@@ -0,0 +1,46 @@
+#ifndef LEVEL_FILE_H
+#define LEVEL_FILE_H
+
+#include <stdbool.h>
+#include "game.h"
+
+// Compiled levels, written by the level compiler from the layer bitmaps and mapped read-only by the server.
+// Everything is little-endian and 4 byte aligned. After the header come palette_count cell definitions
+// (u8 type, r, g, b), then chunk_count LevelFileChunk entries, then the chunk data they point at: for each
+// chunk obstacle_start (CHUNK_COLUMNS + 1 x s32), cells (num_layers * CHUNK_COLUMNS x u8), solid_rows
+// (num_layers * CHUNK_SIZE x u16) and obstacles (obstacle_count x u16), padded to 4 bytes. Last comes the
+// visibility table if the level has one, see visibility.h.
+#define LEVEL_FILE_MAGIC 0x564C4354 // "TCLV"
+#define LEVEL_FILE_VERSION 2
+
+typedef struct LevelFileHeader {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 width;
+    Uint32 height;
+    Uint32 num_layers;
+    Uint32 palette_count;
+    Uint32 chunk_count;
+    Uint32 visibility_region_size; // 0 when the level has no visibility table
+    Uint32 visibility_offset;      // Of the table from the start of the file
+    Uint32 payload_size;     // Bytes after the header
+    Uint32 payload_checksum; // FNV-1a of those bytes
+} LevelFileHeader;
+
+typedef struct LevelFileChunk {
+    Uint16 chunk_x;
+    Uint16 chunk_y;
+    Uint32 offset; // Of the chunk data from the start of the file
+    Uint32 obstacle_count;
+} LevelFileChunk;
+
+// The world's occupancy must be built. The palette is the loaded cell definitions, the visibility table is the
+// world's own if it has one.
+bool write_level_file(const char* path, World* world);
+
+// Sets up the world with its chunks pointing into the mapped file, which must have been compiled with the
+// loaded cell definitions. The cells and the visibility table are read-only. Undo with unmap_level_file instead of world_free.
+bool map_level_file(const char* path, World* world);
+void unmap_level_file(World* world);
+
+#endif // LEVEL_FILE_H
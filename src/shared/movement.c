@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+#include "movement.h"
+#include "game.h"
+#include "vector.h"
+#include "utils.h"
+#include "occupancy.h"
+
+#define MAX_INPUT_DELTA_TIME 0.1f
+#define MAX_SLIDE_PASSES 2
+#define COLLISION_EPSILON 0.001f
+#define MOVEMENT_TIME_CARRY_TICKS 4 // Unused movement time a player may bank, for inputs that arrive in bursts
+
+const float MOUSE_SENSITIVITY = 0.001f;
+
+static vec2 process_input(Player* player, InputState* input_state, float delta_time);
+static void process_mouse(Player* player, InputState* input_state);
+static void update_player_position(Player* player, World* world, float dx, float dy, float deltaTime);
+static vec2 sweep_player_footprint(World* world, vec3 source, vec3 destination, float radius);
+static float sweep_footprint(World* world, vec2 position, vec2 move, float radius, int min_layer, int max_layer, int* out_normal_axis);
+
+void apply_player_movement(Player* player, World* world, InputState* input_state) {
+    // Movement is integrated over the client's own frame time, clamped so a client can't speed itself up
+    float delta_time = fminf(fmaxf(input_state->delta_time, 0.0f), MAX_INPUT_DELTA_TIME);
+
+    vec2 movement = process_input(player, input_state, delta_time);
+    process_mouse(player, input_state);
+
+    update_player_position(player, world, movement.x, movement.y, delta_time);
+}
+
+float get_max_movement_time(float tick_time) {
+    return tick_time * (1 + MOVEMENT_TIME_CARRY_TICKS);
+}
+
+static vec2 process_input(Player* player, InputState* input_state, float delta_time) {
+    vec2 movement = {0.0f, 0.0f};
+    player->jumped = false;
+
+    if (input_state->f.is_down && !input_state->f.was_down) {
+        // Toggle free mode
+        player->free_mode = !player->free_mode;
+    }
+
+    if (input_state->up.is_down) {
+        movement.x += cosf(player->yaw);
+        movement.y += sinf(player->yaw);
+    }
+    if (input_state->down.is_down) {
+        movement.x -= cosf(player->yaw);
+        movement.y -= sinf(player->yaw);
+    }
+    if (input_state->right.is_down) {
+        movement.x -= sinf(player->yaw);
+        movement.y += cosf(player->yaw);
+    }
+    if (input_state->left.is_down) {
+        movement.x += sinf(player->yaw);
+        movement.y -= cosf(player->yaw);
+    }
+
+    // Handle jumping and free mode
+    if (input_state->space.is_down) {
+        if (player->free_mode) {
+            player->position.z -= player->speed * delta_time;
+        } else if (player->velocity_z == 0.0f) { // Jump only when the player is on the ground
+            player->velocity_z = player->jump_velocity;
+            player->jumped = true;
+        }
+    }
+
+    if (player->free_mode && input_state->shift.is_down) {
+        player->position.z += player->speed * delta_time;
+    }
+
+    return movement;
+}
+
+static void process_mouse(Player* player, InputState* input_state) {
+    // Update player's yaw and pitch based on mouse input
+    player->yaw += input_state->mouse_state.dx * MOUSE_SENSITIVITY;
+    player->pitch -= input_state->mouse_state.dy * MOUSE_SENSITIVITY;
+
+    if (player->pitch < -M_PI / 2) {
+        player->pitch = -M_PI / 2;
+    }
+    if (player->pitch > M_PI / 2) {
+        player->pitch = M_PI / 2;
+    }
+}
+
+static void update_player_position(Player* player, World* world, float dx, float dy, float deltaTime) {
+    // Handle free mode unrestricted movement
+    if (player->free_mode) {
+        player->position.x += dx * player->speed * deltaTime;
+        player->position.y += dy * player->speed * deltaTime;
+        player->velocity_z = 0;
+        debuglog(4, "x %f, y %f, z %f \n", player->position.x, player->position.y, player->position.z);
+        return;
+    }
+
+    // Apply gravity
+    player->velocity_z += world->gravity * deltaTime;
+
+    // New player position (to be evaluated)
+    float target_x = player->position.x + dx * player->speed * deltaTime;
+    float target_y = player->position.y + dy * player->speed * deltaTime;
+    float target_z = player->position.z + (player->velocity_z * deltaTime);
+    ivec3 target_grid_pos = get_grid_pos3(target_x, target_y, target_z);
+
+    int z_layer = (int)floor(player->position.z / CELL_Z_SCALE);
+
+    // Calculate the destination position
+    vec3 source = {player->position.x, player->position.y, player->position.z};
+    vec3 destination = {target_x, target_y, target_z};
+
+    // Move as far as the walls allow, sliding along any wall that is hit
+    if (z_layer >= 0) {
+        vec2 legal_position = sweep_player_footprint(world, source, destination, player->size);
+        target_x = legal_position.x;
+        target_y = legal_position.y;
+        // The floor and ceiling come from the column the player slid into, not the one it aimed for
+        target_grid_pos = get_grid_pos3(target_x, target_y, target_z);
+    }
+
+    // z-axis handling
+    float next_z_obstacle;
+    bool has_obstacle_down = get_next_z_obstacle(world, target_grid_pos.x, target_grid_pos.y, target_z, &next_z_obstacle);
+    if (has_obstacle_down) {
+        float highest_valid_z = next_z_obstacle - player->height;
+        if (target_z > highest_valid_z) {
+            // Player z movement is obstructed
+            if (player->velocity_z >= 0) {
+                target_z = highest_valid_z;
+                player->velocity_z = 0.0f;
+            } else {
+                target_z = next_z_obstacle + 0.01f;
+                player->velocity_z = 0.01f;
+            }
+        }
+    }
+
+    // Update player position if the target cell is not solid
+    ivec3 newpos = get_grid_pos3(target_x, target_y, target_z);
+    if (!is_solid_cell(world, newpos)) {
+        if (!(player->position.x == target_x && player->position.y == target_y && player->position.z == target_z)) {
+            debuglog(1, "Player: %d,%d (%f, %f, %d) -> %d,%d (%f, %f, %d) \n", (int)(player->position.x / CELL_XY_SCALE), (int)(player->position.y / CELL_XY_SCALE), player->position.x, player->position.y, z_layer, target_grid_pos.x, target_grid_pos.y, target_x, target_y, (int)floor(target_z / CELL_Z_SCALE));
+        }
+        player->position.x = target_x;
+        player->position.y = target_y;
+        player->position.z = target_z;
+    } else {
+        debuglog(1, "Player: rejected: %d,%d (%f, %f, %d) -> %d,%d (%f, %f, %d) \n", (int)(player->position.x / CELL_XY_SCALE), (int)(player->position.y / CELL_XY_SCALE), player->position.x, player->position.y, z_layer, target_grid_pos.x, target_grid_pos.y, target_x, target_y, (int)floor(target_z / CELL_Z_SCALE));
+        ivec3 old_grid_pos = get_grid_pos3(player->position.x, player->position.y, player->position.z);
+        if (is_solid_cell(world, old_grid_pos)) {
+            player->position.z -= CELL_Z_SCALE;
+        }
+    }
+}
+
+// Moves the player's square footprint (half width radius) from source towards destination through the layers
+// the move spans, stopping at the first solid cell and sliding along it for the rest of the move
+static vec2 sweep_player_footprint(World* world, vec3 source, vec3 destination, float radius) {
+    vec2 position = { source.x, source.y };
+    vec2 move = { destination.x - source.x, destination.y - source.y };
+    int min_layer = (int)floor(fminf(source.z, destination.z) / CELL_Z_SCALE);
+    int max_layer = (int)floor(fmaxf(source.z, destination.z) / CELL_Z_SCALE);
+
+    // Each wall hit removes one axis from the move, so two passes cover sliding into a corner
+    for (int pass = 0; pass < MAX_SLIDE_PASSES && (move.x != 0.0f || move.y != 0.0f); pass++) {
+        int normal_axis = -1;
+        float t = sweep_footprint(world, position, move, radius, min_layer, max_layer, &normal_axis);
+        if (normal_axis < 0) {
+            position = vec2_add(position, move);
+            break;
+        }
+
+        // Move up to the wall, then back off along its normal so the next pass doesn't start touching it.
+        // Backing off along the move instead would leave a grazing hit almost touching the wall.
+        position = vec2_add(position, vec2_multiply_scalar(move, t));
+        vec2 remaining = vec2_multiply_scalar(move, 1.0f - t);
+        if (normal_axis == 0) {
+            position.x -= copysignf(COLLISION_EPSILON, move.x);
+            remaining.x = 0.0f;
+        } else {
+            position.y -= copysignf(COLLISION_EPSILON, move.y);
+            remaining.y = 0.0f;
+        }
+        move = remaining;
+    }
+    return position;
+}
+
+// Time of impact in [0, 1] of the footprint moving by move against the solid cells under its swept bounds,
+// or 1 with out_normal_axis -1 if nothing is hit. Cells the footprint already overlaps are ignored so a
+// player pushed into a wall can walk out of it.
+static float sweep_footprint(World* world, vec2 position, vec2 move, float radius, int min_layer, int max_layer, int* out_normal_axis) {
+    ivec2 min_cell = get_grid_pos2(fminf(position.x, position.x + move.x) - radius, fminf(position.y, position.y + move.y) - radius);
+    ivec2 max_cell = get_grid_pos2(fmaxf(position.x, position.x + move.x) + radius, fmaxf(position.y, position.y + move.y) + radius);
+
+    float first_t = 1.0f;
+    *out_normal_axis = -1;
+    for (int z = min_layer; z <= max_layer; z++) {
+        for (int y = min_cell.y; y <= max_cell.y; y++) {
+            // Only visit the solid cells of the row under the sweep, lowest x first, 64 cells at a time
+            for (int first_x = min_cell.x; first_x <= max_cell.x; first_x += 64) {
+                Uint64 solid = get_solid_span(world, z, y, first_x);
+                int span_length = max_cell.x - first_x + 1;
+                if (span_length < 64) {
+                    solid &= ((Uint64)1 << span_length) - 1;
+                }
+                while (solid) {
+                    int x = first_x + __builtin_ctzll(solid);
+                    solid &= solid - 1;
+
+                    // Sweep the footprint's centre against the cell grown by the footprint (slab test per axis)
+                    float low[2] = { x * CELL_XY_SCALE - radius, y * CELL_XY_SCALE - radius };
+                    float high[2] = { (x + 1) * CELL_XY_SCALE + radius, (y + 1) * CELL_XY_SCALE + radius };
+                    float origin[2] = { position.x, position.y };
+                    float direction[2] = { move.x, move.y };
+                    float t_enter = -INFINITY, t_exit = INFINITY;
+                    int enter_axis = -1;
+                    bool separated = false;
+                    for (int axis = 0; axis < 2; axis++) {
+                        if (direction[axis] == 0.0f) {
+                            separated = separated || origin[axis] <= low[axis] || origin[axis] >= high[axis];
+                            continue;
+                        }
+                        float t0 = (low[axis] - origin[axis]) / direction[axis];
+                        float t1 = (high[axis] - origin[axis]) / direction[axis];
+                        if (t0 > t1) {
+                            float swap = t0;
+                            t0 = t1;
+                            t1 = swap;
+                        }
+                        if (t0 > t_enter) {
+                            t_enter = t0;
+                            enter_axis = axis;
+                        }
+                        t_exit = fminf(t_exit, t1);
+                    }
+                    if (separated || t_enter >= t_exit || t_enter < 0.0f || t_enter >= first_t) {
+                        continue;
+                    }
+                    first_t = t_enter;
+                    *out_normal_axis = enter_axis;
+                }
+            }
+        }
+    }
+    return first_t;
+}
@@ -0,0 +1,13 @@
+#ifndef MOVEMENT_H
+#define MOVEMENT_H
+
+#include "game.h"
+#include "vector.h"
+
+// Player movement shared by the server simulation and client-side prediction
+void apply_player_movement(Player* player, World* world, InputState* input_state);
+
+// Most time the server lets one player's inputs move it in a tick, including what it banked in earlier ticks
+float get_max_movement_time(float tick_time);
+
+#endif // MOVEMENT_H
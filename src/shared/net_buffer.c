@@ -0,0 +1,121 @@
+#include <string.h>
+
+#include "net_buffer.h"
+
+void net_buffer_init(NetBuffer* buffer, void* data, int capacity) {
+    buffer->data = (Uint8*)data;
+    buffer->capacity = capacity;
+    buffer->length = 0;
+    buffer->position = 0;
+    buffer->overflow = false;
+}
+
+void net_buffer_init_read(NetBuffer* buffer, const void* data, int length) {
+    buffer->data = (Uint8*)data;
+    buffer->capacity = length;
+    buffer->length = length;
+    buffer->position = 0;
+    buffer->overflow = false;
+}
+
+void net_write_u8(NetBuffer* buffer, Uint8 value) {
+    if (buffer->length >= buffer->capacity) {
+        buffer->overflow = true;
+        return;
+    }
+    buffer->data[buffer->length++] = value;
+}
+
+void net_write_u16(NetBuffer* buffer, Uint16 value) {
+    net_write_u8(buffer, (Uint8)(value & 0xFF));
+    net_write_u8(buffer, (Uint8)(value >> 8));
+}
+
+void net_write_u32(NetBuffer* buffer, Uint32 value) {
+    net_write_u16(buffer, (Uint16)(value & 0xFFFF));
+    net_write_u16(buffer, (Uint16)(value >> 16));
+}
+
+void net_write_float(NetBuffer* buffer, float value) {
+    Uint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    net_write_u32(buffer, bits);
+}
+
+void net_write_varint(NetBuffer* buffer, Uint32 value) {
+    while (value >= 0x80) {
+        net_write_u8(buffer, (Uint8)(value | 0x80));
+        value >>= 7;
+    }
+    net_write_u8(buffer, (Uint8)value);
+}
+
+void net_write_svarint(NetBuffer* buffer, Sint32 value) {
+    // Zigzag encoding keeps small negative numbers small
+    Uint32 zigzag = ((Uint32)value << 1) ^ (Uint32)(value >> 31);
+    net_write_varint(buffer, zigzag);
+}
+
+void net_write_bytes(NetBuffer* buffer, const void* bytes, int count) {
+    if (buffer->length + count > buffer->capacity) {
+        buffer->overflow = true;
+        return;
+    }
+    memcpy(buffer->data + buffer->length, bytes, count);
+    buffer->length += count;
+}
+
+Uint8 net_read_u8(NetBuffer* buffer) {
+    if (buffer->position >= buffer->length) {
+        buffer->overflow = true;
+        return 0;
+    }
+    return buffer->data[buffer->position++];
+}
+
+Uint16 net_read_u16(NetBuffer* buffer) {
+    Uint16 low = net_read_u8(buffer);
+    Uint16 high = net_read_u8(buffer);
+    return (Uint16)(low | (high << 8));
+}
+
+Uint32 net_read_u32(NetBuffer* buffer) {
+    Uint32 low = net_read_u16(buffer);
+    Uint32 high = net_read_u16(buffer);
+    return low | (high << 16);
+}
+
+float net_read_float(NetBuffer* buffer) {
+    Uint32 bits = net_read_u32(buffer);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+Uint32 net_read_varint(NetBuffer* buffer) {
+    Uint32 value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        Uint8 byte = net_read_u8(buffer);
+        value |= (Uint32)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    buffer->overflow = true; // Malformed varint
+    return 0;
+}
+
+Sint32 net_read_svarint(NetBuffer* buffer) {
+    Uint32 zigzag = net_read_varint(buffer);
+    return (Sint32)(zigzag >> 1) ^ -(Sint32)(zigzag & 1);
+}
+
+void net_read_bytes(NetBuffer* buffer, void* out_bytes, int count) {
+    if (buffer->position + count > buffer->length) {
+        buffer->overflow = true;
+        memset(out_bytes, 0, count);
+        return;
+    }
+    memcpy(out_bytes, buffer->data + buffer->position, count);
+    buffer->position += count;
+}
@@ -0,0 +1,36 @@
+#ifndef NET_BUFFER_H
+#define NET_BUFFER_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+// Byte buffer for building and parsing network messages.
+// Multi-byte values are little-endian; varints use 7 bits per byte.
+typedef struct NetBuffer {
+    Uint8* data;
+    int capacity;
+    int length;   // Bytes written, or bytes available when reading
+    int position; // Read cursor
+    bool overflow; // Set when a write didn't fit or a read ran past the end
+} NetBuffer;
+
+void net_buffer_init(NetBuffer* buffer, void* data, int capacity);
+void net_buffer_init_read(NetBuffer* buffer, const void* data, int length);
+
+void net_write_u8(NetBuffer* buffer, Uint8 value);
+void net_write_u16(NetBuffer* buffer, Uint16 value);
+void net_write_u32(NetBuffer* buffer, Uint32 value);
+void net_write_float(NetBuffer* buffer, float value);
+void net_write_varint(NetBuffer* buffer, Uint32 value);
+void net_write_svarint(NetBuffer* buffer, Sint32 value);
+void net_write_bytes(NetBuffer* buffer, const void* bytes, int count);
+
+Uint8 net_read_u8(NetBuffer* buffer);
+Uint16 net_read_u16(NetBuffer* buffer);
+Uint32 net_read_u32(NetBuffer* buffer);
+float net_read_float(NetBuffer* buffer);
+Uint32 net_read_varint(NetBuffer* buffer);
+Sint32 net_read_svarint(NetBuffer* buffer);
+void net_read_bytes(NetBuffer* buffer, void* out_bytes, int count);
+
+#endif // NET_BUFFER_H
@@ -0,0 +1,159 @@
+#include <string.h>
+
+#include "occupancy.h"
+#include "chunk.h"
+#include "cell_definitions.h"
+
+static int get_column_obstacles(World* world, Chunk* chunk, int column, Uint16* out_obstacles);
+static float get_obstacle_height(Uint16 obstacle);
+
+void build_world_occupancy(World* world) {
+    for (int i = 0; i < world->chunks_x * world->chunks_y; i++) {
+        if (world->chunks[i]) {
+            build_chunk_occupancy(world, world->chunks[i]);
+        }
+    }
+}
+
+bool set_world_cell(World* world, ivec3 grid_position, Cell cell) {
+    if (world->level_file || !is_within_world_bounds(world, grid_position)) {
+        return false;
+    }
+    int chunk_x = grid_position.x >> CHUNK_SHIFT;
+    int chunk_y = grid_position.y >> CHUNK_SHIFT;
+    Chunk* chunk = get_cell_type(cell) == CELL_VOID ? get_chunk(world, chunk_x, chunk_y) : get_or_create_chunk(world, chunk_x, chunk_y);
+    if (!chunk) {
+        return get_cell_type(cell) == CELL_VOID; // Already void
+    }
+    int x = grid_position.x & CHUNK_MASK;
+    int y = grid_position.y & CHUNK_MASK;
+    *get_chunk_cell(chunk, grid_position.z, x, y) = cell;
+
+    Uint16* row = &chunk->solid_rows[grid_position.z * CHUNK_SIZE + y];
+    if (get_cell_type(cell) == CELL_SOLID) {
+        *row |= 1 << x;
+    } else {
+        *row &= ~(1 << x);
+    }
+
+    // Rebuild the cell's column and shift the columns after it by however much it grew or shrank
+    int column = y * CHUNK_SIZE + x;
+    Uint16 obstacles[MAX_LAYERS * 2];
+    int count = get_column_obstacles(world, chunk, column, obstacles);
+    int old_end = chunk->obstacle_start[column + 1];
+    int new_end = chunk->obstacle_start[column] + count;
+    if (new_end != old_end) {
+        memmove(&chunk->obstacles[new_end], &chunk->obstacles[old_end], sizeof(Uint16) * (chunk->obstacle_start[CHUNK_COLUMNS] - old_end));
+        for (int i = column + 1; i <= CHUNK_COLUMNS; i++) {
+            chunk->obstacle_start[i] += new_end - old_end;
+        }
+    }
+    memcpy(&chunk->obstacles[chunk->obstacle_start[column]], obstacles, sizeof(Uint16) * count);
+    return true;
+}
+
+bool is_within_world_bounds(World* world, ivec3 grid_position) {
+    return grid_position.x >= 0 && grid_position.x < world->width &&
+           grid_position.y >= 0 && grid_position.y < world->height &&
+           grid_position.z >= 0 && grid_position.z < world->num_layers;
+}
+
+bool is_solid_cell(World* world, ivec3 grid_position) {
+    if (grid_position.z < 0 || grid_position.z >= world->num_layers) {
+        return false;
+    }
+    Chunk* chunk = get_chunk(world, grid_position.x >> CHUNK_SHIFT, grid_position.y >> CHUNK_SHIFT);
+    if (!chunk) {
+        return false;
+    }
+    Uint16 row = chunk->solid_rows[grid_position.z * CHUNK_SIZE + (grid_position.y & CHUNK_MASK)];
+    return (row >> (grid_position.x & CHUNK_MASK)) & 1;
+}
+
+Uint64 get_solid_span(World* world, int z, int y, int first_x) {
+    if (z < 0 || z >= world->num_layers) {
+        return 0;
+    }
+
+    // Stitch together the rows of the chunks the span crosses
+    Uint64 span = 0;
+    int chunk_y = y >> CHUNK_SHIFT;
+    int row_index = z * CHUNK_SIZE + (y & CHUNK_MASK);
+    for (int chunk_x = first_x >> CHUNK_SHIFT; chunk_x <= (first_x + 63) >> CHUNK_SHIFT; chunk_x++) {
+        Chunk* chunk = get_chunk(world, chunk_x, chunk_y);
+        if (!chunk) {
+            continue;
+        }
+        Uint64 row = chunk->solid_rows[row_index];
+        int offset = chunk_x * CHUNK_SIZE - first_x;
+        span |= offset >= 0 ? row << offset : row >> -offset;
+    }
+    return span;
+}
+
+bool get_next_z_obstacle(World* world, int x, int y, float z, float* out_obstacle_z) {
+    Chunk* chunk = get_chunk(world, x >> CHUNK_SHIFT, y >> CHUNK_SHIFT);
+    if (!chunk) {
+        return false;
+    }
+
+    // Binary search the column for the first height above z
+    int column = (y & CHUNK_MASK) * CHUNK_SIZE + (x & CHUNK_MASK);
+    int low = chunk->obstacle_start[column];
+    int end = chunk->obstacle_start[column + 1];
+    int high = end;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (get_obstacle_height(chunk->obstacles[middle]) > z) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    if (low == end) {
+        return false;
+    }
+    *out_obstacle_z = get_obstacle_height(chunk->obstacles[low]);
+    return true;
+}
+
+void build_chunk_occupancy(World* world, Chunk* chunk) {
+    for (int z = 0; z < world->num_layers; z++) {
+        for (int y = 0; y < CHUNK_SIZE; y++) {
+            Uint16 row = 0;
+            for (int x = 0; x < CHUNK_SIZE; x++) {
+                if (get_cell_type(*get_chunk_cell(chunk, z, x, y)) == CELL_SOLID) {
+                    row |= 1 << x;
+                }
+            }
+            chunk->solid_rows[z * CHUNK_SIZE + y] = row;
+        }
+    }
+
+    int count = 0;
+    for (int column = 0; column < CHUNK_COLUMNS; column++) {
+        chunk->obstacle_start[column] = count;
+        count += get_column_obstacles(world, chunk, column, &chunk->obstacles[count]);
+    }
+    chunk->obstacle_start[CHUNK_COLUMNS] = count;
+}
+
+// Floor tops and ceiling bottoms of a column from the bottom layer up, two at most per layer
+static int get_column_obstacles(World* world, Chunk* chunk, int column, Uint16* out_obstacles) {
+    int count = 0;
+    for (int z = 0; z < world->num_layers; z++) {
+        CellType type = get_cell_type(*get_chunk_cell(chunk, z, column & CHUNK_MASK, column >> CHUNK_SHIFT));
+        if (type == CELL_SOLID || type == CELL_ROOM) {
+            out_obstacles[count++] = (Uint16)(z * 2);
+        }
+        if (type != CELL_VOID) {
+            out_obstacles[count++] = (Uint16)(z * 2 + 1);
+        }
+    }
+    return count;
+}
+
+static float get_obstacle_height(Uint16 obstacle) {
+    float layer_bottom = (float)(obstacle >> 1) * CELL_Z_SCALE;
+    return obstacle & 1 ? layer_bottom + 4 : layer_bottom;
+}
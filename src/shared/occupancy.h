@@ -0,0 +1,25 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include <stdbool.h>
+#include "game.h"
+#include "vector.h"
+
+// Fills in the occupancy of every chunk from its cells
+void build_world_occupancy(World* world);
+void build_chunk_occupancy(World* world, Chunk* chunk);
+
+// Changes one cell, allocating its chunk if needed and updating only that cell's row and column.
+// False if the cell is outside the world or the world is mapped read-only from a level file.
+bool set_world_cell(World* world, ivec3 grid_position, Cell cell);
+
+bool is_within_world_bounds(World* world, ivec3 grid_position);
+bool is_solid_cell(World* world, ivec3 grid_position);
+
+// Solid cells of row y on layer z from first_x to first_x + 63 as bits, zero outside the world
+Uint64 get_solid_span(World* world, int z, int y, int first_x);
+
+// Lowest floor top or ceiling bottom in cell column (x, y) that is above z, false if there is none
+bool get_next_z_obstacle(World* world, int x, int y, float z, float* out_obstacle_z);
+
+#endif // OCCUPANCY_H
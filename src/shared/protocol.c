@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "protocol.h"
+#include "chunk.h"
+#include "cell_definitions.h"
+#include "visibility.h"
+
+#define BUTTON_COUNT 11
+
+// Player ids go on the wire as a single byte
+_Static_assert(MAX_PLAYERS <= 256, "player_id no longer fits the u8 in the input packet");
+
+static void write_input_state(NetBuffer* buffer, const InputState* input_state);
+static void read_input_state(NetBuffer* buffer, InputState* out_input_state);
+
+void write_input_packet(NetBuffer* buffer, const InputPacket* packet) {
+    net_write_u8(buffer, PACKET_INPUT);
+    net_write_u8(buffer, (Uint8)packet->player_id);
+    net_write_u32(buffer, packet->connection_token);
+    net_write_u32(buffer, packet->snapshot_ack);
+    net_write_u8(buffer, (Uint8)packet->input_count);
+    net_write_u32(buffer, packet->input_count > 0 ? packet->inputs[0].sequence : 0);
+    for (int i = 0; i < packet->input_count; i++) {
+        write_input_state(buffer, &packet->inputs[i]);
+    }
+}
+
+bool read_input_packet(NetBuffer* buffer, InputPacket* out_packet) {
+    out_packet->player_id = net_read_u8(buffer);
+    out_packet->connection_token = net_read_u32(buffer);
+    out_packet->snapshot_ack = net_read_u32(buffer);
+    out_packet->input_count = net_read_u8(buffer);
+    Uint32 newest_sequence = net_read_u32(buffer);
+    if (out_packet->input_count > INPUT_REDUNDANCY || out_packet->input_count > newest_sequence) {
+        return false;
+    }
+    for (int i = 0; i < out_packet->input_count; i++) {
+        read_input_state(buffer, &out_packet->inputs[i]);
+        out_packet->inputs[i].sequence = newest_sequence - i;
+    }
+    return !buffer->overflow;
+}
+
+void write_snapshot_packet_header(NetBuffer* buffer, Uint32 input_ack) {
+    net_write_u8(buffer, PACKET_SNAPSHOT);
+    net_write_u32(buffer, input_ack);
+}
+
+bool read_snapshot_packet_header(NetBuffer* buffer, Uint32* out_input_ack) {
+    *out_input_ack = net_read_u32(buffer);
+    return !buffer->overflow;
+}
+
+PacketType read_packet_type(NetBuffer* buffer) {
+    return (PacketType)net_read_u8(buffer);
+}
+
+int get_world_chunk_message_size(const World* world) {
+    // Worst case every cell is its own run, a one byte length and a one byte index
+    return 4 + world->num_layers * CHUNK_COLUMNS * 2;
+}
+
+void write_world_chunk(NetBuffer* buffer, World* world, int chunk_x, int chunk_y) {
+    Chunk* chunk = get_chunk(world, chunk_x, chunk_y);
+    net_write_u16(buffer, (Uint16)chunk_x);
+    net_write_u16(buffer, (Uint16)chunk_y);
+    int cell_count = world->num_layers * CHUNK_COLUMNS;
+    int run_start = 0;
+    for (int i = 1; i <= cell_count; i++) {
+        if (i < cell_count && chunk->cells[i].definition == chunk->cells[run_start].definition) {
+            continue;
+        }
+        net_write_varint(buffer, (Uint32)(i - run_start));
+        net_write_u8(buffer, chunk->cells[run_start].definition);
+        run_start = i;
+    }
+}
+
+Chunk* read_world_chunk(NetBuffer* buffer, int num_layers, int* out_chunk_x, int* out_chunk_y) {
+    *out_chunk_x = net_read_u16(buffer);
+    *out_chunk_y = net_read_u16(buffer);
+    Chunk* chunk = create_chunk(num_layers);
+    if (!chunk) {
+        return NULL;
+    }
+    int cell_count = num_layers * CHUNK_COLUMNS;
+    int filled = 0;
+    while (filled < cell_count) {
+        Uint32 run_length = net_read_varint(buffer);
+        Cell cell = { net_read_u8(buffer) };
+        if (buffer->overflow || run_length == 0 || run_length > (Uint32)(cell_count - filled) ||
+            cell.definition >= get_cell_definition_count()) {
+            free(chunk);
+            return NULL;
+        }
+        for (Uint32 i = 0; i < run_length; i++) {
+            chunk->cells[filled++] = cell;
+        }
+    }
+    return chunk;
+}
+
+int get_world_visibility_message_size(const Visibility* visibility) {
+    return 2 + get_visibility_table_size(visibility);
+}
+
+void write_world_visibility(NetBuffer* buffer, const Visibility* visibility) {
+    net_write_u16(buffer, (Uint16)visibility->region_size);
+    net_write_bytes(buffer, visibility->bits, get_visibility_table_size(visibility));
+}
+
+bool read_world_visibility(NetBuffer* buffer, int world_width, int world_height, Visibility* out_visibility) {
+    int region_size = net_read_u16(buffer);
+    if (buffer->overflow || !visibility_init(out_visibility, region_size, world_width, world_height)) {
+        return false;
+    }
+    int table_size = get_visibility_table_size(out_visibility);
+    net_read_bytes(buffer, out_visibility->bits, table_size);
+    if (buffer->overflow || buffer->position != buffer->length) {
+        visibility_free(out_visibility);
+        return false;
+    }
+    return true;
+}
+
+static void write_input_state(NetBuffer* buffer, const InputState* input_state) {
+    net_write_svarint(buffer, input_state->mouse_state.x);
+    net_write_svarint(buffer, input_state->mouse_state.y);
+    net_write_svarint(buffer, input_state->mouse_state.dx);
+    net_write_svarint(buffer, input_state->mouse_state.dy);
+    // Sent bit-exact so the server integrates the same step the client predicted
+    net_write_float(buffer, input_state->delta_time);
+
+    Uint32 buttons = 0;
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+        buttons |= (input_state->Buttons[i].is_down ? 1u : 0u) << (i * 2);
+        buttons |= (input_state->Buttons[i].was_down ? 1u : 0u) << (i * 2 + 1);
+    }
+    net_write_varint(buffer, buttons);
+}
+
+static void read_input_state(NetBuffer* buffer, InputState* out_input_state) {
+    memset(out_input_state, 0, sizeof(*out_input_state));
+    out_input_state->mouse_state.x = net_read_svarint(buffer);
+    out_input_state->mouse_state.y = net_read_svarint(buffer);
+    out_input_state->mouse_state.dx = net_read_svarint(buffer);
+    out_input_state->mouse_state.dy = net_read_svarint(buffer);
+    out_input_state->delta_time = net_read_float(buffer);
+
+    Uint32 buttons = net_read_varint(buffer);
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+        out_input_state->Buttons[i].is_down = (buttons >> (i * 2)) & 1;
+        out_input_state->Buttons[i].was_down = (buttons >> (i * 2 + 1)) & 1;
+    }
+}
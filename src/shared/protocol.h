@@ -0,0 +1,56 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdbool.h>
+#include "game.h"
+#include "net_buffer.h"
+#include "snapshot.h"
+
+// Number of most recent inputs repeated in every input packet, so a lost packet is covered by the next one
+#define INPUT_REDUNDANCY 4
+// Small enough to cross the internet without IP fragmentation, where losing any fragment loses the datagram
+#define MAX_PACKET_SIZE 1200
+
+typedef enum {
+    PACKET_INPUT = 1,
+    PACKET_SNAPSHOT = 2
+} PacketType;
+
+// Frames on the TCP connection
+typedef enum {
+    MESSAGE_INITIAL_GAME_STATE = 1,
+    MESSAGE_WORLD_CHUNK = 2,
+    MESSAGE_WORLD_VISIBILITY = 3
+} MessageType;
+
+// Client -> server over UDP
+typedef struct InputPacket {
+    int player_id;
+    Uint32 connection_token;
+    Uint32 snapshot_ack; // Tick of the last snapshot the client decoded, used as the delta baseline
+    int input_count;
+    InputState inputs[INPUT_REDUNDANCY]; // Newest first, sequences are consecutive
+} InputPacket;
+
+void write_input_packet(NetBuffer* buffer, const InputPacket* packet);
+bool read_input_packet(NetBuffer* buffer, InputPacket* out_packet);
+
+// Server -> client over UDP, followed by one part of an encoded snapshot
+void write_snapshot_packet_header(NetBuffer* buffer, Uint32 input_ack);
+bool read_snapshot_packet_header(NetBuffer* buffer, Uint32* out_input_ack);
+
+PacketType read_packet_type(NetBuffer* buffer);
+
+// Server -> client over TCP while joining, one allocated chunk of the world with all its layers as
+// run-length coded cell definition indices. Reading returns a new detached chunk, see set_chunk.
+int get_world_chunk_message_size(const World* world);
+void write_world_chunk(NetBuffer* buffer, World* world, int chunk_x, int chunk_y);
+Chunk* read_world_chunk(NetBuffer* buffer, int num_layers, int* out_chunk_x, int* out_chunk_y);
+
+// Server -> client over TCP after the last chunk, the world's visibility table if it has one. The table's layout
+// follows from the region size and the world size. Reading allocates the table, free it with visibility_free.
+int get_world_visibility_message_size(const Visibility* visibility);
+void write_world_visibility(NetBuffer* buffer, const Visibility* visibility);
+bool read_world_visibility(NetBuffer* buffer, int world_width, int world_height, Visibility* out_visibility);
+
+#endif // PROTOCOL_H
@@ -117,6 +117,7 @@ void initialize_default_settings() {
 
     set_setting("server_host", SETTING_TYPE_STRING, "127.0.0.1");
     set_setting("server_port", SETTING_TYPE_INT, "12333");
+    set_setting("interpolation_delay", SETTING_TYPE_FLOAT, "0.1f");
 
     set_setting("gravity", SETTING_TYPE_FLOAT, "15.0f");
     set_setting("free_mode", SETTING_TYPE_BOOL, "false");
@@ -125,11 +126,17 @@ void initialize_default_settings() {
     set_setting("player_pos_z", SETTING_TYPE_FLOAT, "-2.0f");
 
     set_setting("master_volume", SETTING_TYPE_FLOAT, "1.0f");
+    // World units, 0 draws as far as the default far plane
+    set_setting("view_distance", SETTING_TYPE_FLOAT, "0.0f");
 }
 
 void initialize_default_server_settings() {
     set_setting("server_port", SETTING_TYPE_INT, "12333");
     set_setting("current_level", SETTING_TYPE_STRING, "darkchasm");
+    set_setting("tick_rate", SETTING_TYPE_INT, "60");
+    set_setting("max_players", SETTING_TYPE_INT, "64");
+    set_setting("max_projectiles", SETTING_TYPE_INT, "256");
+    set_setting("worker_threads", SETTING_TYPE_INT, "0");
     set_setting("gravity", SETTING_TYPE_FLOAT, "15.0f");
     set_setting("allow_free_mode", SETTING_TYPE_BOOL, "true");
     set_setting("player_pos_x", SETTING_TYPE_FLOAT, "5.0f");
@@ -0,0 +1,413 @@
+#include <math.h>
+#include <string.h>
+
+#include "snapshot.h"
+
+#define POSITION_SCALE 256.0f
+#define ANGLE_SCALE (65536.0f / (2.0f * (float)M_PI))
+#define DIRECTION_SCALE 32767.0f
+#define TIMER_SCALE 100.0f
+
+#define PLAYER_FLAG_FREE_MODE 1
+#define PLAYER_FLAG_JUMPED 2
+
+#define SNAPSHOT_LAST_PART_FLAG 0x80
+#define ENTITY_REMOVED (1u << MAX_ENTITY_FIELDS) // Sent in place of the field mask
+#define ENTITY_RANGE_HEADER_SIZE 6 // First id, end id and record count
+#define MAX_ENTITY_RECORD_SIZE (5 + 5 + MAX_ENTITY_FIELDS * 5)
+
+static Sint32 quantize(float value, float scale);
+static Sint32 quantize_yaw(float yaw);
+static bool encode_entity_range(NetBuffer* buffer, const NetEntity* entities, int count, const NetEntity* baseline, int baseline_count,
+                                int field_count, int wrapped_field, int* first_id, int max_id, int reserve);
+static bool decode_entity_range(NetBuffer* buffer, const NetEntity* baseline, int baseline_count,
+                                NetEntity* entities, Uint8* present, int max_id, int field_count, int wrapped_field);
+static void patch_u16(NetBuffer* buffer, int position, Uint16 value);
+
+void snapshot_capture(Snapshot* snapshot, const GameState* game_state) {
+    snapshot->tick = game_state->tick;
+
+    // Walk indices rather than the pools' dense lists, the encoder needs entities sorted by id
+    snapshot->players_count = 0;
+    for (int i = 0; i < game_state->max_players; i++) {
+        if (!entity_pool_is_live(&game_state->player_pool, i)) {
+            continue;
+        }
+        const Player* player = &game_state->players[i];
+        NetEntity* entity = &snapshot->players[snapshot->players_count++];
+        memset(entity, 0, sizeof(*entity));
+        entity->id = i;
+        entity->fields[PLAYER_FIELD_X] = quantize(player->position.x, POSITION_SCALE);
+        entity->fields[PLAYER_FIELD_Y] = quantize(player->position.y, POSITION_SCALE);
+        entity->fields[PLAYER_FIELD_Z] = quantize(player->position.z, POSITION_SCALE);
+        entity->fields[PLAYER_FIELD_YAW] = quantize_yaw(player->yaw);
+        entity->fields[PLAYER_FIELD_PITCH] = quantize(player->pitch, ANGLE_SCALE);
+        entity->fields[PLAYER_FIELD_VELOCITY_Z] = quantize(player->velocity_z, POSITION_SCALE);
+        entity->fields[PLAYER_FIELD_SPEED] = quantize(player->speed, POSITION_SCALE);
+        entity->fields[PLAYER_FIELD_JUMP_VELOCITY] = quantize(player->jump_velocity, POSITION_SCALE);
+        entity->fields[PLAYER_FIELD_HEIGHT] = quantize(player->height, POSITION_SCALE);
+        entity->fields[PLAYER_FIELD_SIZE] = quantize(player->size, POSITION_SCALE);
+        entity->fields[PLAYER_FIELD_DEATH_TIMER] = quantize(player->death_timer, TIMER_SCALE);
+        entity->fields[PLAYER_FIELD_HEALTH] = player->health;
+        entity->fields[PLAYER_FIELD_FLAGS] = (player->free_mode ? PLAYER_FLAG_FREE_MODE : 0) |
+                                             (player->jumped ? PLAYER_FLAG_JUMPED : 0);
+    }
+
+    const Projectiles* projectiles = &game_state->projectiles;
+    snapshot->projectiles_count = 0;
+    for (int i = 0; i < game_state->max_projectiles; i++) {
+        if (!entity_pool_is_live(&game_state->projectile_pool, i)) {
+            continue;
+        }
+        int p = game_state->projectile_pool.sparse[i];
+        NetEntity* entity = &snapshot->projectiles[snapshot->projectiles_count++];
+        memset(entity, 0, sizeof(*entity));
+        entity->id = i;
+        entity->fields[PROJECTILE_FIELD_X] = quantize(projectiles->x[p], POSITION_SCALE);
+        entity->fields[PROJECTILE_FIELD_Y] = quantize(projectiles->y[p], POSITION_SCALE);
+        entity->fields[PROJECTILE_FIELD_Z] = quantize(projectiles->z[p], POSITION_SCALE);
+        entity->fields[PROJECTILE_FIELD_DIRECTION_X] = quantize(projectiles->direction_x[p], DIRECTION_SCALE);
+        entity->fields[PROJECTILE_FIELD_DIRECTION_Y] = quantize(projectiles->direction_y[p], DIRECTION_SCALE);
+        entity->fields[PROJECTILE_FIELD_DIRECTION_Z] = quantize(projectiles->direction_z[p], DIRECTION_SCALE);
+        entity->fields[PROJECTILE_FIELD_SPEED] = quantize(projectiles->speed[p], POSITION_SCALE);
+        entity->fields[PROJECTILE_FIELD_SIZE] = quantize(projectiles->size[p], POSITION_SCALE);
+        entity->fields[PROJECTILE_FIELD_OWNER] = projectiles->owner[p];
+        entity->fields[PROJECTILE_FIELD_TTL] = projectiles->ttl[p];
+        entity->fields[PROJECTILE_FIELD_ACTIVE] = projectiles->active[p];
+    }
+}
+
+void snapshot_apply(const Snapshot* snapshot, GameState* game_state) {
+    game_state->tick = snapshot->tick;
+
+    // Reset only what was live before, then rebuild the pools from the snapshot
+    for (int i = 0; i < game_state->player_pool.count; i++) {
+        int id = game_state->player_pool.dense[i];
+        game_state->players[id] = (Player) { .id = id };
+    }
+    entity_pool_clear(&game_state->player_pool);
+    for (int i = 0; i < snapshot->players_count; i++) {
+        const NetEntity* entity = &snapshot->players[i];
+        if (!entity_pool_alloc_index(&game_state->player_pool, entity->id)) {
+            continue;
+        }
+        Player* player = &game_state->players[entity->id];
+        player->position.x = entity->fields[PLAYER_FIELD_X] / POSITION_SCALE;
+        player->position.y = entity->fields[PLAYER_FIELD_Y] / POSITION_SCALE;
+        player->position.z = entity->fields[PLAYER_FIELD_Z] / POSITION_SCALE;
+        player->yaw = entity->fields[PLAYER_FIELD_YAW] / ANGLE_SCALE;
+        player->pitch = entity->fields[PLAYER_FIELD_PITCH] / ANGLE_SCALE;
+        player->velocity_z = entity->fields[PLAYER_FIELD_VELOCITY_Z] / POSITION_SCALE;
+        player->speed = entity->fields[PLAYER_FIELD_SPEED] / POSITION_SCALE;
+        player->jump_velocity = entity->fields[PLAYER_FIELD_JUMP_VELOCITY] / POSITION_SCALE;
+        player->height = entity->fields[PLAYER_FIELD_HEIGHT] / POSITION_SCALE;
+        player->size = entity->fields[PLAYER_FIELD_SIZE] / POSITION_SCALE;
+        player->death_timer = entity->fields[PLAYER_FIELD_DEATH_TIMER] / TIMER_SCALE;
+        player->health = entity->fields[PLAYER_FIELD_HEALTH];
+        player->free_mode = (entity->fields[PLAYER_FIELD_FLAGS] & PLAYER_FLAG_FREE_MODE) != 0;
+        player->jumped = (entity->fields[PLAYER_FIELD_FLAGS] & PLAYER_FLAG_JUMPED) != 0;
+        player->connected = true;
+    }
+
+    Projectiles* projectiles = &game_state->projectiles;
+    entity_pool_clear(&game_state->projectile_pool);
+    for (int i = 0; i < snapshot->projectiles_count; i++) {
+        const NetEntity* entity = &snapshot->projectiles[i];
+        int p = game_state_add_projectile(game_state, entity->id);
+        if (p < 0) {
+            continue;
+        }
+        projectiles->x[p] = entity->fields[PROJECTILE_FIELD_X] / POSITION_SCALE;
+        projectiles->y[p] = entity->fields[PROJECTILE_FIELD_Y] / POSITION_SCALE;
+        projectiles->z[p] = entity->fields[PROJECTILE_FIELD_Z] / POSITION_SCALE;
+        projectiles->direction_x[p] = entity->fields[PROJECTILE_FIELD_DIRECTION_X] / DIRECTION_SCALE;
+        projectiles->direction_y[p] = entity->fields[PROJECTILE_FIELD_DIRECTION_Y] / DIRECTION_SCALE;
+        projectiles->direction_z[p] = entity->fields[PROJECTILE_FIELD_DIRECTION_Z] / DIRECTION_SCALE;
+        projectiles->speed[p] = entity->fields[PROJECTILE_FIELD_SPEED] / POSITION_SCALE;
+        projectiles->size[p] = entity->fields[PROJECTILE_FIELD_SIZE] / POSITION_SCALE;
+        projectiles->owner[p] = entity->fields[PROJECTILE_FIELD_OWNER];
+        projectiles->ttl[p] = entity->fields[PROJECTILE_FIELD_TTL];
+        projectiles->active[p] = entity->fields[PROJECTILE_FIELD_ACTIVE] != 0;
+    }
+}
+
+// Player and projectile positions share field indices, so the player ones work for both
+vec3 get_snapshot_entity_position(const NetEntity* entity) {
+    return (vec3) {
+        entity->fields[PLAYER_FIELD_X] / POSITION_SCALE,
+        entity->fields[PLAYER_FIELD_Y] / POSITION_SCALE,
+        entity->fields[PLAYER_FIELD_Z] / POSITION_SCALE
+    };
+}
+
+// Copies only the live entities, a full Snapshot is mostly unused capacity
+void snapshot_copy(Snapshot* destination, const Snapshot* source) {
+    int players_count = source->players_count < MAX_PLAYERS ? source->players_count : MAX_PLAYERS;
+    int projectiles_count = source->projectiles_count < MAX_PROJECTILES ? source->projectiles_count : MAX_PROJECTILES;
+    players_count = players_count > 0 ? players_count : 0;
+    projectiles_count = projectiles_count > 0 ? projectiles_count : 0;
+    destination->tick = source->tick;
+    destination->players_count = players_count;
+    destination->projectiles_count = projectiles_count;
+    memcpy(destination->players, source->players, sizeof(NetEntity) * players_count);
+    memcpy(destination->projectiles, source->projectiles, sizeof(NetEntity) * projectiles_count);
+}
+
+bool snapshot_encode_part(const Snapshot* snapshot, const Snapshot* baseline, SnapshotCursor* cursor, NetBuffer* buffer) {
+    if (cursor->done || cursor->part_index >= SNAPSHOT_MAX_PARTS) {
+        return false;
+    }
+    net_write_u32(buffer, snapshot->tick);
+    net_write_u32(buffer, baseline ? baseline->tick : 0);
+    int part_position = buffer->length;
+    net_write_u8(buffer, (Uint8)cursor->part_index);
+
+    // Players come first, projectiles only start once every player has been covered
+    int player_id = cursor->player_id;
+    int projectile_id = cursor->projectile_id;
+    bool players_done = encode_entity_range(buffer, snapshot->players, snapshot->players_count,
+                                            baseline ? baseline->players : NULL, baseline ? baseline->players_count : 0,
+                                            PLAYER_FIELD_COUNT, PLAYER_FIELD_YAW, &player_id, MAX_PLAYERS, ENTITY_RANGE_HEADER_SIZE);
+    bool projectiles_done = false;
+    if (players_done) {
+        projectiles_done = encode_entity_range(buffer, snapshot->projectiles, snapshot->projectiles_count,
+                                               baseline ? baseline->projectiles : NULL, baseline ? baseline->projectiles_count : 0,
+                                               PROJECTILE_FIELD_COUNT, -1, &projectile_id, MAX_PROJECTILES, 0);
+    } else {
+        // An empty range of projectiles
+        net_write_u16(buffer, (Uint16)projectile_id);
+        net_write_u16(buffer, (Uint16)projectile_id);
+        net_write_u16(buffer, 0);
+    }
+    if (buffer->overflow) {
+        return false;
+    }
+    if (!(players_done && projectiles_done) && player_id == cursor->player_id && projectile_id == cursor->projectile_id) {
+        return false; // Not even one entity fits
+    }
+
+    cursor->done = players_done && projectiles_done;
+    buffer->data[part_position] = (Uint8)(cursor->part_index | (cursor->done ? SNAPSHOT_LAST_PART_FLAG : 0));
+    cursor->part_index++;
+    cursor->player_id = player_id;
+    cursor->projectile_id = projectile_id;
+    return true;
+}
+
+bool snapshot_read_header(NetBuffer* buffer, SnapshotHeader* header) {
+    header->tick = net_read_u32(buffer);
+    header->baseline_tick = net_read_u32(buffer);
+    Uint8 part = net_read_u8(buffer);
+    header->part_index = part & ~SNAPSHOT_LAST_PART_FLAG;
+    header->last_part = (part & SNAPSHOT_LAST_PART_FLAG) != 0;
+    return !buffer->overflow;
+}
+
+void snapshot_assembly_begin(SnapshotAssembly* assembly, const SnapshotHeader* header) {
+    assembly->tick = header->tick;
+    assembly->baseline_tick = header->baseline_tick;
+    memset(assembly->received_parts, 0, sizeof(assembly->received_parts));
+    assembly->part_count = 0;
+    memset(assembly->player_present, 0, sizeof(assembly->player_present));
+    memset(assembly->projectile_present, 0, sizeof(assembly->projectile_present));
+}
+
+bool snapshot_decode_part(NetBuffer* buffer, const SnapshotHeader* header, const Snapshot* baseline, SnapshotAssembly* assembly) {
+    if (header->tick != assembly->tick || header->baseline_tick != assembly->baseline_tick) {
+        return false;
+    }
+    if (header->baseline_tick != 0 && (baseline == NULL || baseline->tick != header->baseline_tick)) {
+        return false; // We no longer have the state this delta was built against
+    }
+    if (header->baseline_tick == 0) {
+        baseline = NULL;
+    }
+    Uint64 part_bit = (Uint64)1 << (header->part_index % 64);
+    if (assembly->received_parts[header->part_index / 64] & part_bit) {
+        return true; // Duplicate
+    }
+
+    if (!decode_entity_range(buffer, baseline ? baseline->players : NULL, baseline ? baseline->players_count : 0,
+                             assembly->players, assembly->player_present, MAX_PLAYERS, PLAYER_FIELD_COUNT, PLAYER_FIELD_YAW) ||
+        !decode_entity_range(buffer, baseline ? baseline->projectiles : NULL, baseline ? baseline->projectiles_count : 0,
+                             assembly->projectiles, assembly->projectile_present, MAX_PROJECTILES, PROJECTILE_FIELD_COUNT, -1)) {
+        return false;
+    }
+    assembly->received_parts[header->part_index / 64] |= part_bit;
+    if (header->last_part) {
+        assembly->part_count = header->part_index + 1;
+    }
+    return true;
+}
+
+bool snapshot_assembly_finish(const SnapshotAssembly* assembly, Snapshot* out_snapshot) {
+    if (assembly->part_count == 0) {
+        return false;
+    }
+    for (int part = 0; part < assembly->part_count; part++) {
+        if (!(assembly->received_parts[part / 64] & ((Uint64)1 << (part % 64)))) {
+            return false;
+        }
+    }
+
+    out_snapshot->tick = assembly->tick;
+    out_snapshot->players_count = 0;
+    for (int id = 0; id < MAX_PLAYERS; id++) {
+        if (assembly->player_present[id]) {
+            out_snapshot->players[out_snapshot->players_count++] = assembly->players[id];
+        }
+    }
+    out_snapshot->projectiles_count = 0;
+    for (int id = 0; id < MAX_PROJECTILES; id++) {
+        if (assembly->projectile_present[id]) {
+            out_snapshot->projectiles[out_snapshot->projectiles_count++] = assembly->projectiles[id];
+        }
+    }
+    return true;
+}
+
+static Sint32 quantize(float value, float scale) {
+    return (Sint32)lroundf(value * scale);
+}
+
+static Sint32 quantize_yaw(float yaw) {
+    // Yaw accumulates without bound, wrap it into one turn
+    return quantize(yaw, ANGLE_SCALE) & 0xFFFF;
+}
+
+static Sint32 field_delta(Sint32 value, Sint32 base, bool wrapped) {
+    return wrapped ? (Sint16)(Uint16)(value - base) : value - base;
+}
+
+// Writes nothing when the entity is unchanged since the baseline, a removed entity is its id and ENTITY_REMOVED
+static void encode_entity(NetBuffer* buffer, int id, const NetEntity* entity, const NetEntity* base, int field_count, int wrapped_field) {
+    if (!entity) {
+        net_write_varint(buffer, (Uint32)id);
+        net_write_varint(buffer, ENTITY_REMOVED);
+        return;
+    }
+
+    Uint32 mask = 0;
+    for (int f = 0; f < field_count; f++) {
+        Sint32 base_value = base ? base->fields[f] : 0;
+        if (entity->fields[f] != base_value) {
+            mask |= 1u << f;
+        }
+    }
+    if (mask == 0 && base != NULL) {
+        return; // Unchanged since the baseline
+    }
+
+    net_write_varint(buffer, (Uint32)id);
+    net_write_varint(buffer, mask);
+    for (int f = 0; f < field_count; f++) {
+        if (mask & (1u << f)) {
+            Sint32 base_value = base ? base->fields[f] : 0;
+            net_write_svarint(buffer, field_delta(entity->fields[f], base_value, f == wrapped_field));
+        }
+    }
+}
+
+// Encodes the changes to entities from *first_id on, walking both id-sorted lists together, for as long as they fit
+// in the buffer with reserve bytes to spare. The range written is [*first_id, end), *first_id is moved to end.
+// Returns true once the range reaches max_id.
+static bool encode_entity_range(NetBuffer* buffer, const NetEntity* entities, int count, const NetEntity* baseline, int baseline_count,
+                                int field_count, int wrapped_field, int* first_id, int max_id, int reserve) {
+    net_write_u16(buffer, (Uint16)*first_id);
+    int end_position = buffer->length;
+    net_write_u16(buffer, 0);
+    int record_count_position = buffer->length;
+    net_write_u16(buffer, 0);
+
+    int c = 0, b = 0;
+    while (c < count && entities[c].id < *first_id) {
+        c++;
+    }
+    while (b < baseline_count && baseline[b].id < *first_id) {
+        b++;
+    }
+    int end_id = max_id;
+    int record_count = 0;
+    while (c < count || b < baseline_count) {
+        int entity_id = c < count ? entities[c].id : max_id;
+        int base_id = b < baseline_count ? baseline[b].id : max_id;
+        int id = entity_id < base_id ? entity_id : base_id;
+        const NetEntity* entity = entity_id == id ? &entities[c] : NULL;
+        const NetEntity* base = base_id == id ? &baseline[b] : NULL;
+
+        Uint8 record_data[MAX_ENTITY_RECORD_SIZE];
+        NetBuffer record;
+        net_buffer_init(&record, record_data, sizeof(record_data));
+        encode_entity(&record, id, entity, base, field_count, wrapped_field);
+        if (record.length > 0) {
+            if (buffer->capacity - buffer->length - reserve < record.length) {
+                end_id = id; // The next part picks up from here
+                break;
+            }
+            net_write_bytes(buffer, record_data, record.length);
+            record_count++;
+        }
+        c += entity != NULL;
+        b += base != NULL;
+    }
+
+    if (!buffer->overflow) {
+        patch_u16(buffer, end_position, (Uint16)end_id);
+        patch_u16(buffer, record_count_position, (Uint16)record_count);
+    }
+    *first_id = end_id;
+    return end_id == max_id;
+}
+
+// Everything in the part's range starts out as it was in the baseline, then the records are applied to it
+static bool decode_entity_range(NetBuffer* buffer, const NetEntity* baseline, int baseline_count,
+                                NetEntity* entities, Uint8* present, int max_id, int field_count, int wrapped_field) {
+    int first_id = net_read_u16(buffer);
+    int end_id = net_read_u16(buffer);
+    int record_count = net_read_u16(buffer);
+    if (buffer->overflow || first_id > end_id || end_id > max_id || record_count > end_id - first_id) {
+        return false;
+    }
+
+    memset(present + first_id, 0, end_id - first_id);
+    for (int b = 0; b < baseline_count && baseline[b].id < end_id; b++) {
+        if (baseline[b].id >= first_id) {
+            entities[baseline[b].id] = baseline[b];
+            present[baseline[b].id] = 1;
+        }
+    }
+
+    int previous_id = first_id - 1;
+    for (int i = 0; i < record_count; i++) {
+        int id = (int)net_read_varint(buffer);
+        Uint32 mask = net_read_varint(buffer);
+        if (buffer->overflow || id <= previous_id || id >= end_id) {
+            return false;
+        }
+        previous_id = id;
+        if (mask & ENTITY_REMOVED) {
+            present[id] = 0;
+            continue;
+        }
+
+        NetEntity* entity = &entities[id];
+        if (!present[id]) {
+            memset(entity, 0, sizeof(*entity));
+            entity->id = id;
+            present[id] = 1;
+        }
+        for (int f = 0; f < field_count; f++) {
+            if (mask & (1u << f)) {
+                Sint32 delta = net_read_svarint(buffer);
+                entity->fields[f] = f == wrapped_field ? (Sint32)((Uint32)(entity->fields[f] + delta) & 0xFFFF)
+                                                       : entity->fields[f] + delta;
+            }
+        }
+    }
+    return !buffer->overflow;
+}
+
+static void patch_u16(NetBuffer* buffer, int position, Uint16 value) {
+    buffer->data[position] = (Uint8)(value & 0xFF);
+    buffer->data[position + 1] = (Uint8)(value >> 8);
+}
@@ -0,0 +1,105 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include "game.h"
+#include "net_buffer.h"
+
+#define SNAPSHOT_HISTORY_SIZE 32
+// A snapshot too big for one packet is sent in parts, each covering its own range of entity ids
+#define SNAPSHOT_MAX_PARTS 128
+
+// Quantized fields are stored as integers so deltas against a baseline are exact
+typedef enum {
+    PLAYER_FIELD_X,
+    PLAYER_FIELD_Y,
+    PLAYER_FIELD_Z,
+    PLAYER_FIELD_YAW,
+    PLAYER_FIELD_PITCH,
+    PLAYER_FIELD_VELOCITY_Z,
+    PLAYER_FIELD_SPEED,
+    PLAYER_FIELD_JUMP_VELOCITY,
+    PLAYER_FIELD_HEIGHT,
+    PLAYER_FIELD_SIZE,
+    PLAYER_FIELD_DEATH_TIMER,
+    PLAYER_FIELD_HEALTH,
+    PLAYER_FIELD_FLAGS,
+    PLAYER_FIELD_COUNT
+} PlayerField;
+
+typedef enum {
+    PROJECTILE_FIELD_X,
+    PROJECTILE_FIELD_Y,
+    PROJECTILE_FIELD_Z,
+    PROJECTILE_FIELD_DIRECTION_X,
+    PROJECTILE_FIELD_DIRECTION_Y,
+    PROJECTILE_FIELD_DIRECTION_Z,
+    PROJECTILE_FIELD_SPEED,
+    PROJECTILE_FIELD_SIZE,
+    PROJECTILE_FIELD_OWNER,
+    PROJECTILE_FIELD_TTL,
+    PROJECTILE_FIELD_ACTIVE,
+    PROJECTILE_FIELD_COUNT
+} ProjectileField;
+
+#define MAX_ENTITY_FIELDS 16
+
+typedef struct NetEntity {
+    int id;
+    Sint32 fields[MAX_ENTITY_FIELDS];
+} NetEntity;
+
+// Quantized game state containing only connected players and live projectiles, sorted by id
+typedef struct Snapshot {
+    Uint32 tick;
+    int players_count;
+    NetEntity players[MAX_PLAYERS];
+    int projectiles_count;
+    NetEntity projectiles[MAX_PROJECTILES];
+} Snapshot;
+
+typedef struct SnapshotHeader {
+    Uint32 tick;
+    Uint32 baseline_tick; // 0 when the snapshot is not delta compressed
+    int part_index;
+    bool last_part;
+} SnapshotHeader;
+
+// Where the next part of a snapshot starts, zeroed before encoding the first one
+typedef struct SnapshotCursor {
+    int part_index;
+    int player_id;
+    int projectile_id;
+    bool done;
+} SnapshotCursor;
+
+// The parts of one tick decoded so far. Parts can arrive in any order, so entities are kept by id until all are in.
+typedef struct SnapshotAssembly {
+    Uint32 tick;
+    Uint32 baseline_tick;
+    Uint64 received_parts[SNAPSHOT_MAX_PARTS / 64];
+    int part_count; // 0 until the last part has arrived
+    NetEntity players[MAX_PLAYERS];
+    NetEntity projectiles[MAX_PROJECTILES];
+    Uint8 player_present[MAX_PLAYERS];
+    Uint8 projectile_present[MAX_PROJECTILES];
+} SnapshotAssembly;
+
+void snapshot_capture(Snapshot* snapshot, const GameState* game_state);
+void snapshot_apply(const Snapshot* snapshot, GameState* game_state);
+void snapshot_copy(Snapshot* destination, const Snapshot* source);
+// Players and projectiles both keep their world position in their first three fields
+vec3 get_snapshot_entity_position(const NetEntity* entity);
+
+// Writes the next part of the snapshot's changes since baseline (NULL for all of it) into what is left of buffer.
+// cursor->done is set once the last part is written; false if not even one entity fits.
+bool snapshot_encode_part(const Snapshot* snapshot, const Snapshot* baseline, SnapshotCursor* cursor, NetBuffer* buffer);
+bool snapshot_read_header(NetBuffer* buffer, SnapshotHeader* header);
+// Starts collecting the parts of a newer tick, dropping whatever was collected before
+void snapshot_assembly_begin(SnapshotAssembly* assembly, const SnapshotHeader* header);
+// baseline must hold the header's baseline tick unless the snapshot isn't delta compressed
+bool snapshot_decode_part(NetBuffer* buffer, const SnapshotHeader* header, const Snapshot* baseline, SnapshotAssembly* assembly);
+// False until every part of the tick has been decoded
+bool snapshot_assembly_finish(const SnapshotAssembly* assembly, Snapshot* out_snapshot);
+
+#endif // SNAPSHOT_H
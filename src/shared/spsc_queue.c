@@ -0,0 +1,71 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "spsc_queue.h"
+
+bool spsc_queue_init(SpscQueue* queue, int item_size, int capacity) {
+    int rounded_capacity = 1;
+    while (rounded_capacity < capacity) {
+        rounded_capacity <<= 1;
+    }
+
+    queue->items = (unsigned char*)malloc((size_t)item_size * rounded_capacity);
+    if (queue->items == NULL) {
+        return false;
+    }
+    queue->item_size = item_size;
+    queue->capacity = rounded_capacity;
+    SDL_AtomicSet(&queue->head, 0);
+    SDL_AtomicSet(&queue->tail, 0);
+    return true;
+}
+
+void spsc_queue_free(SpscQueue* queue) {
+    free(queue->items);
+    queue->items = NULL;
+    queue->capacity = 0;
+}
+
+bool spsc_queue_push(SpscQueue* queue, const void* item) {
+    unsigned int tail = (unsigned int)SDL_AtomicGet(&queue->tail);
+    unsigned int head = (unsigned int)SDL_AtomicGet(&queue->head);
+    if (tail - head >= (unsigned int)queue->capacity) {
+        return false; // Full
+    }
+
+    unsigned int slot = tail & (queue->capacity - 1);
+    memcpy(queue->items + (size_t)slot * queue->item_size, item, queue->item_size);
+
+    // Make the item visible before the consumer can see the new tail
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue->tail, (int)(tail + 1));
+    return true;
+}
+
+bool spsc_queue_pop(SpscQueue* queue, void* out_item) {
+    unsigned int head = (unsigned int)SDL_AtomicGet(&queue->head);
+    unsigned int tail = (unsigned int)SDL_AtomicGet(&queue->tail);
+    if (head == tail) {
+        return false; // Empty
+    }
+    SDL_MemoryBarrierAcquire();
+
+    unsigned int slot = head & (queue->capacity - 1);
+    memcpy(out_item, queue->items + (size_t)slot * queue->item_size, queue->item_size);
+
+    // Finish reading the slot before the producer is allowed to reuse it
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue->head, (int)(head + 1));
+    return true;
+}
+
+// Consumer side only: drops everything currently queued
+void spsc_queue_clear(SpscQueue* queue) {
+    SDL_AtomicSet(&queue->head, SDL_AtomicGet(&queue->tail));
+}
+
+int spsc_queue_count(SpscQueue* queue) {
+    unsigned int tail = (unsigned int)SDL_AtomicGet(&queue->tail);
+    unsigned int head = (unsigned int)SDL_AtomicGet(&queue->head);
+    return (int)(tail - head);
+}
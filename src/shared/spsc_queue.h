@@ -0,0 +1,24 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stdbool.h>
+#include <SDL2/SDL_atomic.h>
+
+// Lock-free ring buffer with exactly one producer thread and one consumer thread.
+// Items are copied in and out by value; capacity is rounded up to a power of two.
+typedef struct SpscQueue {
+    unsigned char* items;
+    int item_size;
+    int capacity;
+    SDL_atomic_t head; // Next slot to read, only advanced by the consumer
+    SDL_atomic_t tail; // Next slot to write, only advanced by the producer
+} SpscQueue;
+
+bool spsc_queue_init(SpscQueue* queue, int item_size, int capacity);
+void spsc_queue_free(SpscQueue* queue);
+bool spsc_queue_push(SpscQueue* queue, const void* item);
+bool spsc_queue_pop(SpscQueue* queue, void* out_item);
+void spsc_queue_clear(SpscQueue* queue);
+int spsc_queue_count(SpscQueue* queue);
+
+#endif // SPSC_QUEUE_H
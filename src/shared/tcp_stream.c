@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <errno.h>
+#include <sys/socket.h>
+#endif
+
+#include "tcp_stream.h"
+#include "net_buffer.h"
+
+#define TCP_STREAM_MIN_CAPACITY 4096
+
+#ifdef _WIN32
+typedef SOCKET SocketHandle;
+#else
+typedef int SocketHandle;
+#endif
+
+// SDL_net only offers a send that waits for every byte, and keeps TCPsocket opaque. This mirrors its private
+// layout to reach the OS socket for non-blocking sends. The layout is the same from 2.0.0 through 2.2.x;
+// check SDLnetTCP.c before allowing a newer version, a mismatch would silently send on the wrong socket.
+#if SDL_NET_MAJOR_VERSION != 2 || SDL_NET_MINOR_VERSION > 2
+#error "struct _TCPsocket below is only known to match SDL_net 2.0 - 2.2"
+#endif
+struct _TCPsocket {
+    int ready;
+    SocketHandle channel;
+    IPaddress remoteAddress;
+    IPaddress localAddress;
+    int sflag;
+};
+
+static int send_without_blocking(TCPsocket socket, const Uint8* data, int length);
+static bool reserve(Uint8** data, int* capacity, int needed);
+static int get_buffered_frame_size(const TcpStream* stream);
+
+void tcp_stream_init(TcpStream* stream, TCPsocket socket) {
+    memset(stream, 0, sizeof(*stream));
+    stream->socket = socket;
+}
+
+void tcp_stream_free(TcpStream* stream) {
+    free(stream->read_data);
+    free(stream->write_data);
+    stream->read_data = NULL;
+    stream->write_data = NULL;
+    stream->read_capacity = stream->read_length = stream->read_position = 0;
+    stream->write_capacity = stream->write_length = stream->write_position = 0;
+}
+
+bool tcp_stream_queue_frame(TcpStream* stream, Uint8 type, const void* data, int length) {
+    if (length < 0 || length > TCP_MAX_FRAME_SIZE) {
+        return false;
+    }
+
+    // Drop what has already been sent before growing
+    if (stream->write_position > 0) {
+        memmove(stream->write_data, stream->write_data + stream->write_position, stream->write_length - stream->write_position);
+        stream->write_length -= stream->write_position;
+        stream->write_position = 0;
+    }
+    if (!reserve(&stream->write_data, &stream->write_capacity, stream->write_length + TCP_FRAME_HEADER_SIZE + length)) {
+        return false;
+    }
+
+    NetBuffer buffer;
+    net_buffer_init(&buffer, stream->write_data + stream->write_length, TCP_FRAME_HEADER_SIZE + length);
+    net_write_u32(&buffer, (Uint32)length);
+    net_write_u8(&buffer, type);
+    net_write_bytes(&buffer, data, length);
+    stream->write_length += buffer.length;
+    return true;
+}
+
+bool tcp_stream_flush(TcpStream* stream, int max_bytes) {
+    int pending = stream->write_length - stream->write_position;
+    int count = pending < max_bytes ? pending : max_bytes;
+    if (count <= 0) {
+        return true;
+    }
+    int sent = send_without_blocking(stream->socket, stream->write_data + stream->write_position, count);
+    if (sent < 0) {
+        return false;
+    }
+    // A peer that stops reading fills its send buffer, the rest waits in write_data for the next flush
+    stream->write_blocked = sent < count;
+    stream->write_position += sent;
+    if (stream->write_position == stream->write_length) {
+        stream->write_position = stream->write_length = 0;
+    }
+    return true;
+}
+
+bool tcp_stream_has_pending_writes(const TcpStream* stream) {
+    return stream->write_position < stream->write_length;
+}
+
+bool tcp_stream_receive(TcpStream* stream) {
+    // Move the unread tail to the front so the buffer only ever holds one partial frame
+    if (stream->read_position > 0) {
+        memmove(stream->read_data, stream->read_data + stream->read_position, stream->read_length - stream->read_position);
+        stream->read_length -= stream->read_position;
+        stream->read_position = 0;
+    }
+
+    int frame_size = get_buffered_frame_size(stream);
+    if (frame_size < 0) {
+        printf("Received a TCP frame larger than %d bytes.\n", TCP_MAX_FRAME_SIZE);
+        return false;
+    }
+    int needed = frame_size > stream->read_length ? frame_size : stream->read_length + TCP_STREAM_MIN_CAPACITY;
+    if (!reserve(&stream->read_data, &stream->read_capacity, needed)) {
+        return false;
+    }
+
+    int received = SDLNet_TCP_Recv(stream->socket, stream->read_data + stream->read_length, stream->read_capacity - stream->read_length);
+    if (received <= 0) {
+        return false;
+    }
+    stream->read_length += received;
+    return true;
+}
+
+bool tcp_stream_next_frame(TcpStream* stream, Uint8* out_type, const Uint8** out_data, int* out_length) {
+    int available = stream->read_length - stream->read_position;
+    if (available < TCP_FRAME_HEADER_SIZE) {
+        return false;
+    }
+
+    NetBuffer buffer;
+    net_buffer_init_read(&buffer, stream->read_data + stream->read_position, available);
+    Uint32 length = net_read_u32(&buffer);
+    Uint8 type = net_read_u8(&buffer);
+    if (length > TCP_MAX_FRAME_SIZE || available < TCP_FRAME_HEADER_SIZE + (int)length) {
+        return false;
+    }
+
+    *out_type = type;
+    *out_data = stream->read_data + stream->read_position + TCP_FRAME_HEADER_SIZE;
+    *out_length = (int)length;
+    stream->read_position += TCP_FRAME_HEADER_SIZE + (int)length;
+    return true;
+}
+
+// Bytes the OS took without waiting, 0 if the send buffer is full, -1 if the connection failed
+static int send_without_blocking(TCPsocket socket, const Uint8* data, int length) {
+#ifdef _WIN32
+    // Winsock has no per-call flag, so the socket is only non-blocking for this send
+    u_long non_blocking = 1;
+    ioctlsocket(socket->channel, FIONBIO, &non_blocking);
+    int sent = send(socket->channel, (const char*)data, length, 0);
+    int error = sent == SOCKET_ERROR ? WSAGetLastError() : 0;
+    non_blocking = 0;
+    ioctlsocket(socket->channel, FIONBIO, &non_blocking);
+    if (sent == SOCKET_ERROR) {
+        return error == WSAEWOULDBLOCK ? 0 : -1;
+    }
+    return sent;
+#else
+    int flags = MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+    flags |= MSG_NOSIGNAL;
+#endif
+    ssize_t sent;
+    do {
+        sent = send(socket->channel, data, length, flags);
+    } while (sent < 0 && errno == EINTR);
+    if (sent < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    return (int)sent;
+#endif
+}
+
+static bool reserve(Uint8** data, int* capacity, int needed) {
+    if (needed <= *capacity) {
+        return true;
+    }
+    int new_capacity = *capacity > 0 ? *capacity : TCP_STREAM_MIN_CAPACITY;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    Uint8* new_data = realloc(*data, new_capacity);
+    if (!new_data) {
+        printf("Failed to allocate TCP buffer of %d bytes.\n", new_capacity);
+        return false;
+    }
+    *data = new_data;
+    *capacity = new_capacity;
+    return true;
+}
+
+// Size of the frame at the read position once its header has arrived: 0 if the header is incomplete,
+// -1 if the announced length is too large
+static int get_buffered_frame_size(const TcpStream* stream) {
+    int available = stream->read_length - stream->read_position;
+    if (available < TCP_FRAME_HEADER_SIZE) {
+        return 0;
+    }
+    NetBuffer buffer;
+    net_buffer_init_read(&buffer, stream->read_data + stream->read_position, available);
+    Uint32 length = net_read_u32(&buffer);
+    if (length > TCP_MAX_FRAME_SIZE) {
+        return -1;
+    }
+    return TCP_FRAME_HEADER_SIZE + (int)length;
+}
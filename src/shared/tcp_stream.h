@@ -0,0 +1,42 @@
+#ifndef TCP_STREAM_H
+#define TCP_STREAM_H
+
+#include <stdbool.h>
+#include <SDL2/SDL_net.h>
+
+// Frames are a little-endian u32 payload length, a u8 message type and the payload
+#define TCP_FRAME_HEADER_SIZE 5
+#define TCP_MAX_FRAME_SIZE (1 << 20)
+
+// Buffered, framed TCP connection. Reads accumulate until a whole frame is available,
+// so a frame split over several SDLNet_TCP_Recv calls is reassembled; writes are queued
+// and flushed a bounded number of bytes at a time without ever waiting on the socket.
+typedef struct TcpStream {
+    TCPsocket socket;
+    Uint8* read_data;
+    int read_capacity;
+    int read_length;
+    int read_position;
+    Uint8* write_data;
+    int write_capacity;
+    int write_length;
+    int write_position;
+    bool write_blocked; // The last flush found the socket's send buffer full
+} TcpStream;
+
+void tcp_stream_init(TcpStream* stream, TCPsocket socket);
+void tcp_stream_free(TcpStream* stream);
+
+bool tcp_stream_queue_frame(TcpStream* stream, Uint8 type, const void* data, int length);
+// Sends what the socket takes right away, up to max_bytes. Returns false once the connection failed.
+bool tcp_stream_flush(TcpStream* stream, int max_bytes);
+bool tcp_stream_has_pending_writes(const TcpStream* stream);
+
+// Reads whatever the socket has into the read buffer; blocks if nothing is ready.
+// Returns false once the connection is closed or sent an invalid frame.
+bool tcp_stream_receive(TcpStream* stream);
+
+// Takes the next complete frame, if any. The payload stays valid until the next receive.
+bool tcp_stream_next_frame(TcpStream* stream, Uint8* out_type, const Uint8** out_data, int* out_length);
+
+#endif // TCP_STREAM_H
@@ -8,6 +8,8 @@
 #include "utils.h"
 #include "vector.h"
 #include "game.h"
+#include "chunk.h"
+#include "occupancy.h"
 
 bool enable_debuglog = false;
 
@@ -24,6 +26,10 @@ void debuglog(int one_in_n_chance, const char* format, ...)
     }
 }
 
+double get_time_seconds() {
+    return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+}
+
 SDL_Surface* load_surface(const char* filename) {
     SDL_Surface* image = IMG_Load(filename);
     if (!image) {
@@ -55,37 +61,25 @@ Uint32 get_pixel32(SDL_Surface* surface, int x, int y) {
     }
 }
 
-Cell* get_cell(Layer* layer, int x, int y) {
-    if (is_out_of_xy_bounds(layer, x, y)) {
-        return NULL;
-    }
-    return &layer->cells[y][x];
-}
-
-bool is_out_of_xy_bounds(Layer* layer, int x, int y) {
-    return x < 0 || x >= layer->width || y < 0 || y >= layer->height;
-}
-
-bool is_within_xy_bounds(Layer* layer, int x, int y) {
-    return x >= 0 && x < layer->width && y >= 0 && y < layer->height;
-}
-
 bool get_world_cell(World* world, ivec3 grid_position, Cell** out_cell) {
-    if (grid_position.z < 0 || grid_position.z >= world->num_layers) {
+    // Chunks that were never allocated are all void, they all share this cell which must not be written
+    static Cell void_cell = { 0 };
+    if (!is_within_world_bounds(world, grid_position)) {
         return false;
     }
-    Layer* layer = &world->layers[grid_position.z];
-    if (grid_position.y < 0 || grid_position.y >= layer->width || grid_position.x < 0 || grid_position.x >= layer->height) {
-        return false;
+    Chunk* chunk = get_chunk(world, grid_position.x >> CHUNK_SHIFT, grid_position.y >> CHUNK_SHIFT);
+    if (!chunk) {
+        *out_cell = &void_cell;
+        return true;
     }
-    *out_cell = &layer->cells[grid_position.y][grid_position.x];
+    *out_cell = get_chunk_cell(chunk, grid_position.z, grid_position.x & CHUNK_MASK, grid_position.y & CHUNK_MASK);
     return true;
 }
 
 vec3 get_random_world_pos(World* world) {
     int z = rand() % (world->num_layers + 1);
-    int x = rand() % (world->layers[0].width + 1);
-    int y = rand() % (world->layers[0].height + 1);
+    int x = rand() % (world->width + 1);
+    int y = rand() % (world->height + 1);
     return (vec3) {
         .x = x * CELL_XY_SCALE,
         .y = y * CELL_XY_SCALE,
@@ -66,6 +66,10 @@ void vec3_cross(const vec3* a, const vec3* b, vec3* result) {
     result->z = a->x * b->y - a->y * b->x;
 }
 
+float vec3_dot(vec3 a, vec3 b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
 float vec3_distance(vec3 a, vec3 b) {
     vec3 diff = vec3_subtract(a, b);
     return vec3_length(diff);
@@ -104,3 +108,31 @@ float point_to_aabb_distance_3d(float px, float py, float pz, float min_x, float
     float dz = MAX(MAX(min_z - pz, pz - max_z), 0);
     return sqrt(dx * dx + dy * dy + dz * dz);
 }
+
+// Earliest point along start -> end, as a fraction in [0, 1], where a sphere swept along the segment
+// touches a sphere at center. radius is the sum of both radii.
+bool segment_sphere_intersection(vec3 start, vec3 end, vec3 center, float radius, float* out_t) {
+    vec3 d = vec3_subtract(end, start);
+    vec3 m = vec3_subtract(start, center);
+    float c = m.x * m.x + m.y * m.y + m.z * m.z - radius * radius;
+    if (c <= 0.0f) {
+        *out_t = 0.0f; // Already touching at the start
+        return true;
+    }
+
+    float a = d.x * d.x + d.y * d.y + d.z * d.z;
+    float b = m.x * d.x + m.y * d.y + m.z * d.z;
+    if (a <= 0.0f || b >= 0.0f) {
+        return false; // Not moving, or moving away
+    }
+    float discriminant = b * b - a * c;
+    if (discriminant < 0.0f) {
+        return false;
+    }
+    float t = (-b - sqrtf(discriminant)) / a;
+    if (t > 1.0f) {
+        return false;
+    }
+    *out_t = t;
+    return true;
+}
@@ -1,5 +1,6 @@
 #ifndef VECTOR_H
 #define VECTOR_H
+#include <stdbool.h>
 #include <SDL2/SDL_image.h>
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
@@ -37,9 +38,11 @@ vec3 vec3_normalize(vec3 a);
 vec3 vec3_multiply_scalar(vec3 a, float scalar);
 float vec3_length(vec3 a);
 void vec3_cross(const vec3* a, const vec3* b, vec3* result);
+float vec3_dot(vec3 a, vec3 b);
 float vec3_distance(vec3 a, vec3 b);
 
 ivec3 get_grid_pos3(float x, float y, float z);
+bool segment_sphere_intersection(vec3 start, vec3 end, vec3 center, float radius, float* out_t);
 float point_to_aabb_distance_3d(float px, float py, float pz, float min_x, float min_y, float min_z, float max_x, float max_y, float max_z);
 
 #endif // VECTOR_H
@@ -0,0 +1,107 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "visibility.h"
+
+int get_visibility_region_size(int width, int height) {
+    for (int size = VISIBILITY_MIN_REGION_SIZE; size <= VISIBILITY_MAX_REGION_SIZE; size *= 2) {
+        int regions_x = (width + size - 1) / size;
+        int regions_y = (height + size - 1) / size;
+        if (regions_x * regions_y <= VISIBILITY_MAX_REGIONS) {
+            return size;
+        }
+    }
+    return 0;
+}
+
+bool visibility_init(Visibility* visibility, int region_size, int width, int height) {
+    *visibility = (Visibility) { 0 };
+    if (region_size < VISIBILITY_MIN_REGION_SIZE || region_size > VISIBILITY_MAX_REGION_SIZE || (region_size & (region_size - 1)) != 0 ||
+        width < 1 || height < 1 || width > MAX_WORLD_SIZE || height > MAX_WORLD_SIZE) {
+        return false;
+    }
+    int regions_x = (width + region_size - 1) / region_size;
+    int regions_y = (height + region_size - 1) / region_size;
+    if (regions_x * regions_y > VISIBILITY_MAX_REGIONS) {
+        return false;
+    }
+    int row_bytes = (regions_x * regions_y + 7) / 8;
+    Uint8* bits = calloc(regions_x * regions_y, row_bytes);
+    if (!bits) {
+        printf("Failed to allocate the visibility table.\n");
+        return false;
+    }
+    *visibility = (Visibility) {
+        .region_size = region_size,
+        .regions_x = regions_x,
+        .regions_y = regions_y,
+        .row_bytes = row_bytes,
+        .bits = bits
+    };
+    return true;
+}
+
+void visibility_free(Visibility* visibility) {
+    free(visibility->bits);
+    *visibility = (Visibility) { 0 };
+}
+
+int get_visibility_table_size(const Visibility* visibility) {
+    return visibility->regions_x * visibility->regions_y * visibility->row_bytes;
+}
+
+int get_visibility_region(const Visibility* visibility, vec3 position) {
+    if (visibility->region_size == 0) {
+        return -1;
+    }
+    int x = (int)floorf(position.x / CELL_XY_SCALE);
+    int y = (int)floorf(position.y / CELL_XY_SCALE);
+    if (x < 0 || y < 0) {
+        return -1;
+    }
+    int region_x = x / visibility->region_size;
+    int region_y = y / visibility->region_size;
+    if (region_x >= visibility->regions_x || region_y >= visibility->regions_y) {
+        return -1;
+    }
+    return region_y * visibility->regions_x + region_x;
+}
+
+bool is_region_visible(const Visibility* visibility, int from_region, int region) {
+    if (from_region < 0 || region < 0) {
+        return true;
+    }
+    return (visibility->bits[from_region * visibility->row_bytes + (region >> 3)] >> (region & 7)) & 1;
+}
+
+bool is_position_visible(const Visibility* visibility, int from_region, vec3 position) {
+    return is_region_visible(visibility, from_region, get_visibility_region(visibility, position));
+}
+
+bool is_chunk_visible(const Visibility* visibility, int from_region, int chunk_x, int chunk_y) {
+    if (from_region < 0) {
+        return true;
+    }
+    int first_x = chunk_x * CHUNK_SIZE - 1;
+    int first_y = chunk_y * CHUNK_SIZE - 1;
+    int last_x = first_x + CHUNK_SIZE + 1;
+    int last_y = first_y + CHUNK_SIZE + 1;
+    int first_region_x = MAX(first_x, 0) / visibility->region_size;
+    int first_region_y = MAX(first_y, 0) / visibility->region_size;
+    int last_region_x = last_x / visibility->region_size;
+    int last_region_y = last_y / visibility->region_size;
+    last_region_x = last_region_x < visibility->regions_x ? last_region_x : visibility->regions_x - 1;
+    last_region_y = last_region_y < visibility->regions_y ? last_region_y : visibility->regions_y - 1;
+
+    const Uint8* row = &visibility->bits[from_region * visibility->row_bytes];
+    for (int region_y = first_region_y; region_y <= last_region_y; region_y++) {
+        for (int region_x = first_region_x; region_x <= last_region_x; region_x++) {
+            int region = region_y * visibility->regions_x + region_x;
+            if ((row[region >> 3] >> (region & 7)) & 1) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
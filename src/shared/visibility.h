@@ -0,0 +1,32 @@
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+#include <stdbool.h>
+#include "game.h"
+#include "vector.h"
+
+// Potentially visible sets between regions of the world. They are computed offline by the level compiler,
+// stored in the level file and sent to clients after the world's chunks. A world without them, or a position
+// outside every region, sees everything.
+
+// Region side lengths in cells, a power of two that divides CHUNK_SIZE or is a multiple of it
+#define VISIBILITY_MIN_REGION_SIZE 4
+#define VISIBILITY_MAX_REGION_SIZE 64
+// Keeps the table within one TCP frame, 2048 * 2048 bits is 512 KiB
+#define VISIBILITY_MAX_REGIONS 2048
+
+// The smallest region size that keeps a width x height world within VISIBILITY_MAX_REGIONS, 0 if none does
+int get_visibility_region_size(int width, int height);
+// Allocates a table where nothing is visible yet, covering a width x height world
+bool visibility_init(Visibility* visibility, int region_size, int width, int height);
+void visibility_free(Visibility* visibility);
+int get_visibility_table_size(const Visibility* visibility);
+
+// The region a world position is in, -1 when there is no visibility data or the position is outside the world
+int get_visibility_region(const Visibility* visibility, vec3 position);
+bool is_region_visible(const Visibility* visibility, int from_region, int region);
+bool is_position_visible(const Visibility* visibility, int from_region, vec3 position);
+// Faces on a chunk's edge are seen through its neighbors' cells, so the regions one cell around it count too
+bool is_chunk_visible(const Visibility* visibility, int from_region, int chunk_x, int chunk_y);
+
+#endif // VISIBILITY_H
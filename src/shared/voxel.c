@@ -0,0 +1,57 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "voxel.h"
+#include "occupancy.h"
+
+bool traverse_voxels(World* world, vec3 source, vec3 destination, VoxelVisitor visitor, void* user_data) {
+    float cell_size[3] = { CELL_XY_SCALE, CELL_XY_SCALE, CELL_Z_SCALE };
+    float start[3] = { source.x, source.y, source.z };
+    float direction[3] = { destination.x - source.x, destination.y - source.y, destination.z - source.z };
+    int cell[3], end_cell[3], step[3];
+    float t_max[3], t_delta[3];
+    int steps = 0;
+
+    for (int axis = 0; axis < 3; axis++) {
+        cell[axis] = (int)floorf(start[axis] / cell_size[axis]);
+        end_cell[axis] = (int)floorf((start[axis] + direction[axis]) / cell_size[axis]);
+        steps += abs(end_cell[axis] - cell[axis]);
+
+        // t_max: fraction of the segment at which the next boundary on this axis is crossed,
+        // t_delta: fraction it takes to cross a whole cell on this axis
+        if (direction[axis] > 0.0f) {
+            step[axis] = 1;
+            t_max[axis] = ((cell[axis] + 1) * cell_size[axis] - start[axis]) / direction[axis];
+            t_delta[axis] = cell_size[axis] / direction[axis];
+        } else if (direction[axis] < 0.0f) {
+            step[axis] = -1;
+            t_max[axis] = (cell[axis] * cell_size[axis] - start[axis]) / direction[axis];
+            t_delta[axis] = -cell_size[axis] / direction[axis];
+        } else {
+            step[axis] = 0;
+            t_max[axis] = INFINITY;
+            t_delta[axis] = INFINITY;
+        }
+    }
+
+    // The step count is fixed up front so rounding in t_max can never run the walk past the end cell
+    for (int i = 0; i <= steps; i++) {
+        ivec3 grid_position = { cell[0], cell[1], cell[2] };
+        if (is_within_world_bounds(world, grid_position) && !visitor(world, grid_position, user_data)) {
+            return false;
+        }
+
+        int axis = t_max[0] < t_max[1] ? (t_max[0] < t_max[2] ? 0 : 2) : (t_max[1] < t_max[2] ? 1 : 2);
+        if (step[axis] == 0 || cell[axis] == end_cell[axis]) {
+            // Rounding picked an axis that is already done, advance one that isn't
+            for (axis = 0; axis < 3 && cell[axis] == end_cell[axis]; axis++) {
+            }
+            if (axis == 3) {
+                break;
+            }
+        }
+        cell[axis] += step[axis];
+        t_max[axis] += t_delta[axis];
+    }
+    return true;
+}
@@ -0,0 +1,16 @@
+#ifndef VOXEL_H
+#define VOXEL_H
+
+#include <stdbool.h>
+#include "game.h"
+#include "vector.h"
+
+// Called for every world cell a segment passes through, in order from the source. Visitors that only
+// care about collision should ask the world's occupancy rather than load the cell. Return false to stop the walk early.
+typedef bool (*VoxelVisitor)(World* world, ivec3 grid_position, void* user_data);
+
+// Walks the cells from source to destination with an Amanatides-Woo DDA, so no cell the segment touches is skipped.
+// Cells outside the world are stepped over without a visit. Returns false if the visitor stopped the walk.
+bool traverse_voxels(World* world, vec3 source, vec3 destination, VoxelVisitor visitor, void* user_data);
+
+#endif // VOXEL_H
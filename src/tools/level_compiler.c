@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "../server/world.h"
+#include "../shared/cell_definitions.h"
+#include "../shared/level_file.h"
+#include "../shared/job_system.h"
+#include "../shared/visibility.h"
+#include "../shared/utils.h"
+#include "visibility_compiler.h"
+
+// Compiles levels/<name>/*.bmp into levels/<name>.level, which the server maps instead of parsing the bitmaps.
+// The level's visibility table is computed here too, it is too slow to do when the server starts.
+// Run from the workspace folder so cell_definitions.txt is the one the server and clients load.
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        printf("Usage: level_compiler <level name>\n");
+        return 2;
+    }
+    const char* level_name = argv[1];
+
+    if (!load_cell_definitions("cell_definitions.txt")) {
+        return 1;
+    }
+    static World world;
+    if (!load_world_from_bitmaps(&world, level_name)) {
+        printf("Failed to load level %s.\n", level_name);
+        return 1;
+    }
+
+    double start_time = get_time_seconds();
+    if (!job_system_init(0)) {
+        free_world(&world);
+        return 1;
+    }
+    bool computed = compute_visibility(&world, &world.visibility);
+    job_system_shutdown();
+    if (!computed) {
+        free_world(&world);
+        return 1;
+    }
+    if (world.visibility.bits) {
+        int region_count = world.visibility.regions_x * world.visibility.regions_y;
+        int visible_count = 0;
+        for (int from_region = 0; from_region < region_count; from_region++) {
+            for (int region = 0; region < region_count; region++) {
+                visible_count += is_region_visible(&world.visibility, from_region, region);
+            }
+        }
+        printf("Computed visibility between %d regions of %dx%d cells in %.0f ms, each sees %.0f%% of them on average.\n",
+               region_count, world.visibility.region_size, world.visibility.region_size,
+               (get_time_seconds() - start_time) * 1000.0, 100.0 * visible_count / ((double)region_count * region_count));
+    }
+
+    char level_path[256];
+    snprintf(level_path, sizeof(level_path), "levels/%s.level", level_name);
+    bool written = write_level_file(level_path, &world);
+    free_world(&world);
+    if (!written) {
+        return 1;
+    }
+    printf("Wrote %s.\n", level_path);
+    return 0;
+}
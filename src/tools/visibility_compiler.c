@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "visibility_compiler.h"
+#include "../shared/visibility.h"
+#include "../shared/occupancy.h"
+#include "../shared/voxel.h"
+#include "../shared/job_system.h"
+
+// Open cells per region that rays are cast from
+#define VISIBILITY_SAMPLES 16
+
+typedef struct {
+    World* world;
+    Visibility* visibility;
+    vec3* targets; // Points all over the world's bounding box, every ray ends at one
+    int target_count;
+} VisibilityJob;
+
+// What a ray marks the regions it passes through in
+typedef struct {
+    Visibility* visibility;
+    int region;
+} RegionMarker;
+
+static vec3* create_targets(World* world, int region_size, int* out_count);
+static int collect_region_samples(World* world, int region_size, int region_x, int region_y, vec3* out_samples);
+static void compute_region_rows(void* data, int begin, int end, int worker_index);
+static bool mark_visible_region(World* world, ivec3 grid_position, void* user_data);
+static void set_region_and_neighbors_visible(Visibility* visibility, int from_region, int region);
+static void set_region_visible(Visibility* visibility, int from_region, int region);
+
+bool compute_visibility(World* world, Visibility* out_visibility) {
+    *out_visibility = (Visibility) { 0 };
+    int region_size = get_visibility_region_size(world->width, world->height);
+    if (region_size == 0) {
+        printf("The world is too large for visibility data, everything will count as visible.\n");
+        return true;
+    }
+    if (!visibility_init(out_visibility, region_size, world->width, world->height)) {
+        return false;
+    }
+    VisibilityJob job = { .world = world, .visibility = out_visibility };
+    job.targets = create_targets(world, region_size, &job.target_count);
+    if (!job.targets) {
+        printf("Failed to allocate the visibility targets.\n");
+        visibility_free(out_visibility);
+        return false;
+    }
+
+    // Each job owns its regions' rows
+    int region_count = out_visibility->regions_x * out_visibility->regions_y;
+    job_system_parallel_for(compute_region_rows, &job, region_count, 1);
+    free(job.targets);
+
+    // Rays from a few samples can miss a sight line that only just clears a wall, so whatever is seen from
+    // a region also makes the regions around it visible, both ways since sight goes both ways
+    int table_size = get_visibility_table_size(out_visibility);
+    Uint8* seen = malloc(table_size);
+    if (!seen) {
+        printf("Failed to allocate the visibility table.\n");
+        visibility_free(out_visibility);
+        return false;
+    }
+    memcpy(seen, out_visibility->bits, table_size);
+    for (int region = 0; region < region_count; region++) {
+        for (int other_region = 0; other_region < region_count; other_region++) {
+            if ((seen[region * out_visibility->row_bytes + (other_region >> 3)] >> (other_region & 7)) & 1) {
+                set_region_and_neighbors_visible(out_visibility, region, other_region);
+            }
+        }
+    }
+    free(seen);
+    return true;
+}
+
+// Points on every face of the world's bounding box, a layer apart vertically and half a region apart otherwise.
+// That is as fine as the rays have to fan out for what they find to be right to the region.
+static vec3* create_targets(World* world, int region_size, int* out_count) {
+    int stride = region_size / 2;
+    int columns = (world->width + stride - 1) / stride;
+    int rows = (world->height + stride - 1) / stride;
+    vec3* targets = malloc(sizeof(vec3) * 2 * ((columns + rows) * world->num_layers + columns * rows));
+    if (!targets) {
+        return NULL;
+    }
+    float width = (float)world->width * CELL_XY_SCALE;
+    float height = (float)world->height * CELL_XY_SCALE;
+    float depth = (float)world->num_layers * CELL_Z_SCALE;
+    int count = 0;
+    for (int z = 0; z < world->num_layers; z++) {
+        float target_z = (z + 0.5f) * CELL_Z_SCALE;
+        for (int x = 0; x < columns; x++) {
+            targets[count++] = (vec3) { (x * stride + 0.5f) * CELL_XY_SCALE, 0.0f, target_z };
+            targets[count++] = (vec3) { (x * stride + 0.5f) * CELL_XY_SCALE, height, target_z };
+        }
+        for (int y = 0; y < rows; y++) {
+            targets[count++] = (vec3) { 0.0f, (y * stride + 0.5f) * CELL_XY_SCALE, target_z };
+            targets[count++] = (vec3) { width, (y * stride + 0.5f) * CELL_XY_SCALE, target_z };
+        }
+    }
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < columns; x++) {
+            targets[count++] = (vec3) { (x * stride + 0.5f) * CELL_XY_SCALE, (y * stride + 0.5f) * CELL_XY_SCALE, 0.0f };
+            targets[count++] = (vec3) { (x * stride + 0.5f) * CELL_XY_SCALE, (y * stride + 0.5f) * CELL_XY_SCALE, depth };
+        }
+    }
+    *out_count = count;
+    return targets;
+}
+
+// Spread over the open cells of the region in layer, row and column order, at the cells' centers
+static int collect_region_samples(World* world, int region_size, int region_x, int region_y, vec3* out_samples) {
+    int first_x = region_x * region_size;
+    int first_y = region_y * region_size;
+    int last_x = first_x + region_size < world->width ? first_x + region_size : world->width;
+    int last_y = first_y + region_size < world->height ? first_y + region_size : world->height;
+
+    int open_count = 0;
+    for (int z = 0; z < world->num_layers; z++) {
+        for (int y = first_y; y < last_y; y++) {
+            for (int x = first_x; x < last_x; x++) {
+                open_count += !is_solid_cell(world, (ivec3) { x, y, z });
+            }
+        }
+    }
+
+    int sample_count = open_count < VISIBILITY_SAMPLES ? open_count : VISIBILITY_SAMPLES;
+    int open_index = 0;
+    int next_sample = 0;
+    for (int z = 0; z < world->num_layers && next_sample < sample_count; z++) {
+        for (int y = first_y; y < last_y && next_sample < sample_count; y++) {
+            for (int x = first_x; x < last_x && next_sample < sample_count; x++) {
+                if (is_solid_cell(world, (ivec3) { x, y, z })) {
+                    continue;
+                }
+                if (open_index++ == next_sample * open_count / sample_count) {
+                    out_samples[next_sample++] = (vec3) {
+                        (x + 0.5f) * CELL_XY_SCALE,
+                        (y + 0.5f) * CELL_XY_SCALE,
+                        (z + 0.5f) * CELL_Z_SCALE
+                    };
+                }
+            }
+        }
+    }
+    return sample_count;
+}
+
+static void compute_region_rows(void* data, int begin, int end, int worker_index) {
+    VisibilityJob* job = (VisibilityJob*)data;
+    Visibility* visibility = job->visibility;
+    for (int region = begin; region < end; region++) {
+        vec3 samples[VISIBILITY_SAMPLES];
+        int sample_count = collect_region_samples(job->world, visibility->region_size, region % visibility->regions_x,
+                                                  region / visibility->regions_x, samples);
+        // Only something moving through walls can be in a solid region, it may see anything
+        if (sample_count == 0) {
+            memset(&visibility->bits[region * visibility->row_bytes], 0xFF, visibility->row_bytes);
+            continue;
+        }
+        RegionMarker marker = { visibility, region };
+        for (int i = 0; i < sample_count; i++) {
+            for (int t = 0; t < job->target_count; t++) {
+                traverse_voxels(job->world, samples[i], job->targets[t], mark_visible_region, &marker);
+            }
+        }
+    }
+}
+
+static bool mark_visible_region(World* world, ivec3 grid_position, void* user_data) {
+    if (is_solid_cell(world, grid_position)) {
+        return false;
+    }
+    RegionMarker* marker = (RegionMarker*)user_data;
+    int region_size = marker->visibility->region_size;
+    int region = grid_position.y / region_size * marker->visibility->regions_x + grid_position.x / region_size;
+    set_region_visible(marker->visibility, marker->region, region);
+    return true;
+}
+
+static void set_region_and_neighbors_visible(Visibility* visibility, int from_region, int region) {
+    int region_x = region % visibility->regions_x;
+    int region_y = region / visibility->regions_x;
+    for (int y = MAX(region_y - 1, 0); y <= region_y + 1 && y < visibility->regions_y; y++) {
+        for (int x = MAX(region_x - 1, 0); x <= region_x + 1 && x < visibility->regions_x; x++) {
+            set_region_visible(visibility, from_region, y * visibility->regions_x + x);
+            set_region_visible(visibility, y * visibility->regions_x + x, from_region);
+        }
+    }
+}
+
+static void set_region_visible(Visibility* visibility, int from_region, int region) {
+    visibility->bits[from_region * visibility->row_bytes + (region >> 3)] |= (Uint8)(1 << (region & 7));
+}
@@ -0,0 +1,14 @@
+#ifndef VISIBILITY_COMPILER_H
+#define VISIBILITY_COMPILER_H
+
+#include <stdbool.h>
+#include "../shared/game.h"
+
+// Fills in which regions of the world may see each other. Rays fan out from a spread of open cells in every
+// region to all over the world's bounding box, and each region they pass through before a solid cell is visible.
+// Only solid cells block sight. To make up for the sampling the regions around anything seen count as seen too,
+// and regions without open cells see everything. The world's occupancy must be built and the job system running.
+// A world too large for any region size gets no table, false only when out of memory.
+bool compute_visibility(World* world, Visibility* out_visibility);
+
+#endif // VISIBILITY_COMPILER_H